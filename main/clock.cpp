@@ -2,27 +2,90 @@
 //   SPDX-License-Identifier: MIT
 
 #include "clock.h"
+#include "digit_ticker.h"
 #include "drivers/lcds.h"
+#include "flip_cache.h"
+#include "glyph_cache.h"
 #include "gui.h"
+#include <algorithm>
 #include <ctime>
+#include <sys/time.h>
 
 #include <lvgl.h>
 
-constexpr auto FLIP_SPACING_MS = 700;
-
-const std::vector<std::string> digits_loop = {"",  ":", "0", "1", "2", "3",
-                                              "4", "5", "6", "7", "8", "9"};
-
-const std::vector<std::string> divider_loop = {"", ":"};
+// SPI bytes a second flips may send between them, of the 5 MB/s the bus
+// has, and how many they may send at once: about one flip's worth, so each
+// step of a wave waits for the one to its left to have had a share of the bus
+constexpr uint32_t FLIP_BUS_BUDGET = 1000 * 1000;
+constexpr uint32_t FLIP_BUS_BURST = 400 * 1000;
+// Work out the next minute's flips this long before it turns over, so at the
+// minute itself they only have to be started; 0 does it all on the minute
+constexpr uint32_t CLOCK_LOOKAHEAD_MS = 3000;
+constexpr uint32_t MINUTE_MS = 60 * 1000;
+// How long the digit tickers of the faster modes slide for, at most; tenths
+// change ten times a second and have to be done well inside one
+constexpr uint32_t TICKER_SLIDE_MS = 200;
+constexpr uint32_t TICKER_TENTHS_SLIDE_MS = 60;
+constexpr uint32_t TENTH_MS = 100;
+constexpr uint32_t SECOND_MS = 1000;
+// The hinge the divider image covers, across the flap face
+constexpr lv_coord_t DIVIDER_X = 8;
+constexpr lv_coord_t DIVIDER_Y = 75;
+constexpr lv_coord_t DIVIDER_WIDTH = 64;
+// How far above the middle of a panel the digit labels sit
+constexpr lv_coord_t DIGIT_LABEL_Y = -7;
+
+static_assert(CLOCK_DIGIT_PANELS == NUM_LCDS - 1);
+static_assert(CLOCK_DIGIT_SYMBOLS.size() == NUM_DIGIT_SPRITES);
+static_assert(CLOCK_LETTER_A == NUM_DIGIT_SPRITES);
+static_assert(CLOCK_AMPM_SYMBOLS.size() == NUM_AMPM_SPRITES);
+static_assert(CLOCK_MAX_STEPS <= FLAP_SEQUENCE_MAX_STEPS);
 
 static const lv_color_t TEXT_COLOR = lv_color_hex(0xFCF9D9);
 
+// The rows a digit label's letters can cover on a panel, across the flap
+// face, worked out the way LVGL centres the label so any panel's ticker can
+// use them, the AM/PM one included
+static lv_area_t digit_ticker_area(lv_obj_t *background_image) {
+  lv_obj_update_layout(background_image);
+  lv_coord_t line_height = lv_font_get_line_height(&oswald_100);
+  auto y1 = (lv_coord_t)(lv_obj_get_height(background_image) / 2 -
+                         line_height / 2 + DIGIT_LABEL_Y);
+  return {.x1 = DIVIDER_X,
+          .y1 = y1,
+          .x2 = DIVIDER_X + DIVIDER_WIDTH - 1,
+          .y2 = (lv_coord_t)(y1 + line_height - 1)};
+}
+
 static void timer_callback(lv_timer_t *timer) {
   auto *instance = static_cast<class clock *>(timer->user_data);
-  instance->update();
+  instance->minute_timer();
+}
+
+static void fast_timer_callback(lv_timer_t *timer) {
+  auto *instance = static_cast<class clock *>(timer->user_data);
+  instance->fast_timer();
+}
+
+static struct tm local_time(time_t time) {
+  struct tm timeinfo {};
+#ifdef __MINGW32__
+  localtime_s(&timeinfo, &time);
+#else
+  localtime_r(&time, &timeinfo);
+#endif
+  return timeinfo;
+}
+
+// How far into its minute the wall clock is, to the millisecond
+static uint32_t minute_elapsed_ms(const timeval &now, const struct tm &time) {
+  return time.tm_sec * 1000 + now.tv_usec / 1000;
 }
 
-clock::clock() {
+clock::clock() : flip_scheduler_(FLIP_BUS_BUDGET, FLIP_BUS_BURST) {
+  glyph_cache_add_font(&oswald_100);
+  glyph_cache_add_font(&oswald_60);
+
   for (int i = 0; i < NUM_LCDS; i++) {
     lv_disp_set_default(gui_get_display(i));
     lv_obj_t *screen = lv_scr_act();
@@ -31,7 +94,7 @@ clock::clock() {
     lv_img_set_src(background_image, "S:/spiffs/split_flap.png");
     lv_obj_set_pos(background_image, 0, 0);
 
-    flappers[i] = new flapper(background_image);
+    flappers[i] = new flapper(background_image, &snapshots, &hot_rows);
 
     lv_obj_set_style_text_color(screen, TEXT_COLOR, LV_PART_MAIN);
 
@@ -42,7 +105,7 @@ clock::clock() {
       lv_label_set_text_static(label, "");
       digit_labels[i] = label;
 
-      lv_obj_align(label, LV_ALIGN_CENTER, 0, -7);
+      lv_obj_align(label, LV_ALIGN_CENTER, 0, DIGIT_LABEL_Y);
     } else {
       lv_obj_set_style_text_font(screen, &oswald_60, LV_PART_MAIN);
 
@@ -57,160 +120,437 @@ clock::clock() {
       lv_label_set_text_static(ampm_label_bottom, "");
     }
 
+    // under the divider, like the labels
+    tickers[i] = new digit_ticker(
+        background_image, digit_ticker_area(background_image), &oswald_100,
+        TEXT_COLOR, &flip_scheduler_, i);
+
     lv_obj_t *divider_image = lv_img_create(background_image);
-    lv_obj_set_pos(divider_image, 8, 75);
+    lv_obj_set_pos(divider_image, DIVIDER_X, DIVIDER_Y);
     lv_img_set_src(divider_image, "S:/spiffs/split_flap_divider.png");
   }
 
+  for (size_t i = 0; i < digit_panels.size(); i++) {
+    digit_panel &panel = digit_panels[i];
+    panel.owner = this;
+    panel.index = i;
+    panel.sequence.bind(
+        flappers[i], &flip_scheduler_, i,
+        [](uint8_t value, void *user_data) {
+          auto *panel = static_cast<digit_panel *>(user_data);
+          panel->owner->set_digit(panel->index, value);
+        },
+        [](uint8_t value, void *user_data) {
+          return static_cast<digit_panel *>(user_data)->owner->digit_sprite(
+              value);
+        },
+        [](uint8_t, uint8_t, void *user_data) {
+          return static_cast<digit_panel *>(user_data)->owner->transition;
+        },
+        &panel);
+  }
+
+  build_sprites();
+
+  // no digits are showing yet, so every panel is the same background
+  gui_broadcast_refresh(0, LCD_ALL_MASK);
+
   clock_update_timer = lv_timer_create(timer_callback, 60000, this);
+  fast_update_timer = lv_timer_create(fast_timer_callback, TENTH_MS, this);
+  lv_timer_pause(fast_update_timer);
 }
 
-void clock::update() {
-  time_t now = 0;
-  char strftime_buf[64];
-  struct tm timeinfo {};
+void clock::set_mode(clock_mode mode, uint32_t countdown_ms) {
+  this->mode = mode;
+  mode_start_ms = lv_tick_get();
+  this->countdown_ms = countdown_ms;
 
-  time(&now);
+  if (mode == clock_mode::time || mode == clock_mode::text) {
+    lv_timer_pause(fast_update_timer);
+    for (digit_ticker *ticker : tickers) {
+      ticker->show(false);
+    }
+  }
+  if (mode == clock_mode::time) {
+    update(); // flaps the time back in from wherever the panels are
+    return;
+  }
 
-#ifdef __MINGW32__
-  localtime_s(&timeinfo, &now);
-#else
-  localtime_r(&now, &timeinfo);
-#endif
+  // nothing of the minute's is left to start
+  prepared = false;
+  for (digit_panel &panel : digit_panels) {
+    panel.pending = false;
+  }
 
-  strftime(strftime_buf, sizeof(strftime_buf), "%I:%M%p", &timeinfo);
+  if (mode == clock_mode::text) {
+    // show_text() heads on from whatever the digit panels are doing, and
+    // AM/PM flips away
+    ampm_pending = ampm_shown != CLOCK_BLANK;
+    ampm_from = ampm_shown;
+    ampm_to = ampm_shown = CLOCK_BLANK;
+    commit();
+    return;
+  }
 
-  char *next_digit = strftime_buf;
-  size_t i = 0;
-  uint32_t delay = 0;
+  // The tickers take over from blank panels, with nothing flipping under them
+  for (digit_panel &panel : digit_panels) {
+    set_digit(panel.index, CLOCK_BLANK);
+    panel.sequence.set(CLOCK_BLANK, nullptr, 0);
+  }
+  flip_scheduler_.cancel(NUM_LCDS - 1);
+  ampm_pending = false;
+  set_ampm_labels(CLOCK_BLANK);
+  ampm_shown = CLOCK_BLANK;
+
+  for (size_t i = 0; i < NUM_LCDS; i++) {
+    flappers[i]->clear();
+    tickers[i]->show(true);
+  }
 
-  for (auto &digit_label : digit_labels) {
-    char digit = *next_digit;
-    char text[2] = {digit, '\0'};
+  lv_timer_resume(fast_update_timer);
+  fast_timer();
+}
 
-    if (digit != '\0') {
-      next_digit++;
+// Shows the mode's next value on the tickers and waits for the one after
+void clock::fast_timer() {
+  uint32_t elapsed_ms = lv_tick_elaps(mode_start_ms);
+  uint32_t period_ms = TENTH_MS - elapsed_ms % TENTH_MS;
+  uint32_t minutes = 0, seconds = 0;
+  int tenths = -1; // none shown
+
+  switch (mode) {
+  case clock_mode::seconds: {
+    timeval now{};
+    gettimeofday(&now, nullptr);
+    struct tm time = local_time(now.tv_sec);
+    minutes = time.tm_min;
+    seconds = time.tm_sec;
+    period_ms = SECOND_MS - now.tv_usec / 1000;
+    break;
+  }
+  case clock_mode::stopwatch:
+    tenths = static_cast<int>(elapsed_ms / TENTH_MS);
+    break;
+  case clock_mode::countdown:
+    // rounded up, so zero shows once it has actually run out
+    tenths = static_cast<int>(
+        (std::max(countdown_ms, elapsed_ms) - elapsed_ms + TENTH_MS - 1) /
+        TENTH_MS);
+    if (tenths == 0) {
+      lv_timer_pause(fast_update_timer);
     }
+    break;
+  case clock_mode::time:
+  case clock_mode::text:
+    return;
+  }
+  if (tenths >= 0) {
+    seconds = tenths / 10 % 60;
+    minutes = tenths / 600 % 100;
+    tenths %= 10;
+  }
+
+  uint32_t tenths_letter = tenths >= 0 ? '0' + tenths : 0;
+  const uint32_t letters[NUM_LCDS] = {'0' + minutes / 10, '0' + minutes % 10,
+                                      ':',                '0' + seconds / 10,
+                                      '0' + seconds % 10, tenths_letter};
+  // the colon just appears, it never changes after
+  const uint32_t slide_ms[NUM_LCDS] = {TICKER_SLIDE_MS, TICKER_SLIDE_MS, 0,
+                                       TICKER_SLIDE_MS, TICKER_SLIDE_MS,
+                                       TICKER_TENTHS_SLIDE_MS};
+  for (size_t i = 0; i < NUM_LCDS; i++) {
+    tickers[i]->set(letters[i], slide_ms[i]);
+  }
+
+  lv_timer_set_period(fast_update_timer, period_ms);
+  lv_timer_reset(fast_update_timer);
+}
 
-    char *existing_text = lv_label_get_text(digit_label);
+const digit_ticker_stats &clock::ticker_stats(size_t panel) const {
+  return tickers[panel]->stats();
+}
+
+void clock::reset_ticker_stats() {
+  for (digit_ticker *ticker : tickers) {
+    ticker->reset_stats();
+  }
+}
 
-    if (strcmp(existing_text, text) != 0) {
-      flapper *flapper = flappers[i];
-      std::vector<std::string> values = {};
+// Each panel flips straight to its symbol, from wherever it is going now, so
+// a newer text never waits behind an older one or tears a flip down
+void clock::show_text(const std::array<uint8_t, CLOCK_DIGIT_PANELS> &symbols) {
+  if (mode != clock_mode::text) {
+    set_mode(clock_mode::text);
+  }
+
+  for (digit_panel &panel : digit_panels) {
+    uint8_t symbol = symbols[panel.index];
+    panel.sequence.retarget(&symbol, symbol != panel.sequence.value() ? 1 : 0);
+  }
+}
 
-      auto existing_string = std::string(existing_text);
-      auto desired_string = std::string(text);
-      auto &character_loop = (desired_string == ":") ? divider_loop : digits_loop;
+void clock::update() {
+  if (mode != clock_mode::time) {
+    return;
+  }
 
-      auto start_iter =
-          std::find(character_loop.cbegin(),
-                                  character_loop.cend(), existing_string);
-      auto end_iter =
-          std::find(character_loop.cbegin(), character_loop.cend(), desired_string);
+  timeval now{};
+  gettimeofday(&now, nullptr);
+  struct tm time = local_time(now.tv_sec);
 
-      LV_ASSERT(start_iter != character_loop.cend());
-      LV_ASSERT(end_iter != character_loop.cend());
+  update(time);
 
-      auto iter = start_iter;
-      while (true) {
-        iter++;
-        if (iter == character_loop.cend()) {
-          iter = character_loop.cbegin();
-        }
+  // on time for the minute rather than whenever in the second it was called
+  uint32_t remaining_ms = MINUTE_MS - minute_elapsed_ms(now, time);
+  wait_for_minute(remaining_ms);
+}
 
-        auto &value = *iter;
-        values.push_back(value);
-        if (iter == end_iter) {
-          break;
-        }
-      }
-
-      auto existing_timer = delayed_start_timers[i];
-      if (existing_timer != nullptr) {
-        lv_timer_del(existing_timer);
-        delayed_start_timers[i] = nullptr;
-      }
-
-      flap_sequences[i] = std::make_unique<flap_sequence>(
-          flapper,
-          [&digit_label](const std::string &value) {
-            lv_label_set_text(digit_label, value.c_str());
-          },
-          values);
-
-      struct timer_user_data {
-        clock *this_;
-        size_t index;
-      };
-      auto *start_delayed_timer = lv_timer_create(
-          [](lv_timer_t *timer) {
-            auto *user_data =
-                static_cast<struct timer_user_data *>(timer->user_data);
-            user_data->this_->delayed_start_flap_sequence(user_data->index);
-
-            delete user_data;
-          },
-          delay, new timer_user_data{this, i});
-      lv_timer_set_repeat_count(start_delayed_timer, 1);
-
-      delay += FLIP_SPACING_MS;
+void clock::update(const struct tm &time) {
+  prepared = false;
+  boundary_panel = NUM_LCDS; // nothing to time this against
+  prepare(time);
+  commit();
+}
+
+void clock::minute_timer() {
+  if (mode != clock_mode::time) {
+    return; // set_mode() picks the minute back up
+  }
+
+  if (prepared) {
+    prepared = false;
+    commit();
+    watch_boundary();
+    // from the minute just committed, not the wall clock, which can still
+    // read the last one
+    uint32_t late_ms = lv_tick_elaps(boundary_tick);
+    wait_for_minute(late_ms < MINUTE_MS ? MINUTE_MS - late_ms : MINUTE_MS);
+    return;
+  }
+
+  timeval now{};
+  gettimeofday(&now, nullptr);
+  struct tm time = local_time(now.tv_sec);
+  uint32_t elapsed_ms = minute_elapsed_ms(now, time);
+  uint32_t remaining_ms = MINUTE_MS - elapsed_ms;
+
+  if (CLOCK_LOOKAHEAD_MS == 0 || remaining_ms > CLOCK_LOOKAHEAD_MS + 1000) {
+    // on the minute, or the wall clock moved since the timer was set
+    uint32_t tick = lv_tick_get();
+    update(time);
+    if (remaining_ms > MINUTE_MS - 1000) { // this is the minute turning over
+      boundary_tick = tick - elapsed_ms;
+      boundary_panel = first_changed_panel;
+      watch_boundary();
+    }
+    wait_for_minute(remaining_ms);
+    return;
+  }
+
+  prepare(local_time(now.tv_sec + (60 - time.tm_sec)));
+  prepared = true;
+  boundary_tick = lv_tick_get() + remaining_ms;
+  boundary_panel = first_changed_panel;
+  lv_timer_set_period(clock_update_timer, remaining_ms);
+  lv_timer_reset(clock_update_timer);
+}
+
+// Wakes up ahead of the minute to prepare it, if there is time to
+void clock::wait_for_minute(uint32_t remaining_ms) {
+  uint32_t period_ms = remaining_ms > CLOCK_LOOKAHEAD_MS
+                           ? remaining_ms - CLOCK_LOOKAHEAD_MS
+                           : remaining_ms;
+  lv_timer_set_period(clock_update_timer, period_ms);
+  lv_timer_reset(clock_update_timer);
+}
+
+// Sets each panel's run for time going, without starting any of them
+void clock::prepare(const struct tm &time) {
+  clock_face face = clock_face_at(time);
+  first_changed_panel = NUM_LCDS;
+
+  for (digit_panel &panel : digit_panels) {
+    uint8_t symbol = face.digits[panel.index];
+    panel.pending = symbol != panel.shown;
+    if (!panel.pending) {
+      continue;
+    }
+    first_changed_panel = std::min(first_changed_panel, panel.index);
+
+    std::array<uint8_t, CLOCK_MAX_STEPS> steps;
+    size_t count =
+        symbol == CLOCK_COLON
+            ? clock_steps(CLOCK_DIVIDER_LOOP, panel.shown, symbol, steps)
+            : clock_steps(CLOCK_DIGITS_LOOP, panel.shown, symbol, steps);
+    if (count == 0) { // from a letter, which neither loop goes through
+      steps[0] = symbol;
+      count = 1;
+    }
+    panel.sequence.set(panel.shown, steps.data(), count);
+  }
+
+  ampm_pending = face.ampm != ampm_shown;
+  if (ampm_pending) {
+    first_changed_panel = std::min(first_changed_panel, NUM_LCDS - 1);
+    ampm_from = ampm_shown;
+    ampm_to = face.ampm;
+    ampm_shown = face.ampm;
+  }
+}
+
+// Starts what prepare() set up
+void clock::commit() {
+  // left to right, so the scheduler starts the wave in that order
+  for (digit_panel &panel : digit_panels) {
+    if (panel.pending) {
+      panel.pending = false;
+      panel.sequence.start();
     }
+  }
 
-    i++;
+  if (ampm_pending) {
+    ampm_pending = false;
+    flapper *flapper = flappers[NUM_LCDS - 1];
+    flip_scheduler_.request(
+        NUM_LCDS - 1, flapper->estimated_bus_bytes(transition_flip),
+        [](void *user_data) {
+          static_cast<class clock *>(user_data)->flip_ampm();
+        },
+        this);
   }
+}
+
+// Has the first panel the committed minute changes say when its flip first
+// moves, which is timed as it happens rather than whenever it is asked for,
+// so the steps after the first don't count
+void clock::watch_boundary() {
+  if (boundary_panel >= NUM_LCDS) {
+    return;
+  }
+
+  flappers[boundary_panel]->watch_motion(
+      [](uint32_t tick_ms, void *user_data) {
+        auto *this_ = static_cast<class clock *>(user_data);
+        auto since_ms = static_cast<int32_t>(tick_ms - this_->boundary_tick);
+        // not if update() or another minute has been timed since
+        if (this_->boundary_panel < NUM_LCDS && !this_->prepared &&
+            since_ms >= 0) {
+          this_->boundary_latency = since_ms;
+          this_->boundary_panel = NUM_LCDS;
+        }
+      },
+      this);
+}
 
-  char digit = *next_digit;
+void clock::flip_ampm() {
+  flapper *flapper = flappers[NUM_LCDS - 1];
+  flapper->before(ampm_sprite(ampm_from));
+  set_ampm_labels(ampm_to);
+  flapper->after(ampm_sprite(ampm_to));
+  flapper->start(true);
+}
 
-  char *existing_ampm_text = lv_label_get_text(ampm_label_top);
-  char existing_digit = *existing_ampm_text;
+bool clock::flipping() const {
+  for (const digit_panel &panel : digit_panels) {
+    if (!panel.sequence.finished()) {
+      return true;
+    }
+  }
+  for (const flapper *flapper : flappers) {
+    if (flapper->flipping()) {
+      return true;
+    }
+  }
+  for (const digit_ticker *ticker : tickers) {
+    if (ticker->moving()) {
+      return true;
+    }
+  }
+  return flip_scheduler_.stats().queue_depth > 0;
+}
 
-  if (digit != existing_digit) {
-    flapper *flapper = flappers[i];
-    flapper->before();
-    if (digit == 'A') {
-      lv_label_set_text_static(ampm_label_top, "A");
-    } else if (digit == 'P') {
-      lv_label_set_text_static(ampm_label_top, "P");
+// Every face the panels can show, rendered on the first boot of a build and
+// mapped out of the flip cache after that
+void clock::build_sprites() {
+  if (!flip_cache_load(NUM_SPRITES, SPRITE_IMAGE_SIZE, LCD_HEIGHT)) {
+    render_sprites();
+    if (!flip_cache_save(sprites, SPRITE_IMAGE_SIZE, LCD_HEIGHT) ||
+        !flip_cache_load(NUM_SPRITES, SPRITE_IMAGE_SIZE, LCD_HEIGHT)) {
+      return; // flip from the copies in PSRAM
     }
+    sprites.clear();
+  }
 
-    lv_label_set_text_static(ampm_label_bottom, "M");
-    flapper->after();
-    flapper->start(true);
+  for (size_t i = 0; i < NUM_SPRITES; i++) {
+    sprites.add(flip_cache_image(i));
   }
+}
 
-  auto remaining_seconds = 60 - timeinfo.tm_sec;
-  lv_timer_set_period(clock_update_timer, remaining_seconds * 1000);
-  lv_timer_reset(clock_update_timer);
+// Renders every face the panels can show once. The first digit panel stands
+// in for all of them since they only differ in their label.
+void clock::render_sprites() {
+  for (const char *symbol : CLOCK_DIGIT_SYMBOLS) {
+    lv_label_set_text_static(digit_labels[0], symbol);
+    sprites.add(background_images[0]);
+  }
+  for (const char *symbol : CLOCK_LETTER_SYMBOLS) {
+    lv_label_set_text_static(digit_labels[0], symbol);
+    sprites.add(background_images[0]);
+  }
+  lv_label_set_text_static(digit_labels[0], "");
+
+  lv_obj_t *ampm_panel = background_images[NUM_LCDS - 1];
+  for (uint8_t symbol = 0; symbol < CLOCK_AMPM_SYMBOLS.size(); symbol++) {
+    set_ampm_labels(symbol);
+    sprites.add(ampm_panel);
+  }
+  set_ampm_labels(CLOCK_BLANK);
+}
+
+void clock::set_digit(size_t index, uint8_t symbol) {
+  lv_label_set_text_static(digit_labels[index],
+                           symbol < CLOCK_LETTER_A
+                               ? CLOCK_DIGIT_SYMBOLS[symbol]
+                               : CLOCK_LETTER_SYMBOLS[symbol - CLOCK_LETTER_A]);
+  digit_panels[index].shown = symbol;
+}
+
+void clock::set_ampm_labels(uint8_t symbol) {
+  lv_label_set_text_static(ampm_label_top, CLOCK_AMPM_SYMBOLS[symbol]);
+  lv_label_set_text_static(ampm_label_bottom,
+                           symbol == CLOCK_BLANK ? "" : "M");
+}
+
+const lv_img_dsc_t *clock::digit_sprite(uint8_t symbol) const {
+  return sprites.get(symbol);
 }
 
-void clock::delayed_start_flap_sequence(size_t index) {
-  flap_sequences[index]->start();
-  delayed_start_timers[index] = nullptr;
+const lv_img_dsc_t *clock::ampm_sprite(uint8_t symbol) const {
+  return sprites.get(NUM_DIGIT_SPRITES + NUM_LETTER_SPRITES + symbol);
 }
 
 void clock::shuffle() {
-  char buf[10] = {
-      0,
-  };
-  snprintf(buf, sizeof(buf), "%d", rand() % 10);
-  buf[sizeof(buf) - 1] = '\0';
+  auto digit = static_cast<uint8_t>(CLOCK_DIGIT_0 + rand() % 10);
 
-  for (auto &digit_label : digit_labels) {
-    if(digit_label == digit_labels[2]) {
-      lv_label_set_text_static(digit_label, "");
-    } else {
-      lv_label_set_text_static(digit_label, buf);
-    }
+  for (size_t i = 0; i < digit_labels.size(); i++) {
+    set_digit(i, i == 2 ? CLOCK_BLANK : digit);
   }
 
-  lv_label_set_text_static(ampm_label_top, "");
-  lv_label_set_text_static(ampm_label_bottom, "");
+  flip_scheduler_.cancel(NUM_LCDS - 1);
+  set_ampm_labels(CLOCK_BLANK);
+  ampm_shown = CLOCK_BLANK;
 
   update();
 }
 
 clock::~clock() {
   lv_timer_del(clock_update_timer);
+  lv_timer_del(fast_update_timer);
+
+  for (auto &ticker : tickers) {
+    delete ticker;
+  }
+
 
   for (auto &flapper : flappers) {
     delete flapper;
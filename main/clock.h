@@ -4,15 +4,38 @@
 #pragma once
 
 #include <array>
+#include <ctime>
 #include <lvgl.h>
-#include <memory>
 
+#include "clock_face.h"
+#include "digit_ticker.h"
 #include "drivers/lcds.h"
 #include "flapper.h"
+#include "flip_scheduler.h"
 #include "gui.h"
+#include "snapshot_pool.h"
+#include "sprite_atlas.h"
 
 #include "flap_sequence.h"
 
+// "", ":", 0-9 and the letters for the digit panels; blank, AM and PM for
+// the last one. 31 faces, about 800 KB of the 1 MB flip cache.
+constexpr size_t NUM_DIGIT_SPRITES = 12;
+constexpr size_t NUM_LETTER_SPRITES = CLOCK_LETTER_SYMBOLS.size();
+constexpr size_t NUM_AMPM_SPRITES = 3;
+constexpr size_t NUM_SPRITES =
+    NUM_DIGIT_SPRITES + NUM_LETTER_SPRITES + NUM_AMPM_SPRITES;
+constexpr size_t SPRITE_IMAGE_SIZE =
+    LCD_WIDTH * LCD_HEIGHT * sizeof(lv_color_t);
+
+enum class clock_mode {
+  time,      // hours and minutes, flapping over once a minute
+  seconds,   // minutes and seconds of the time, on the digit tickers
+  stopwatch, // minutes, seconds and tenths since the mode was set
+  countdown, // the same, down to zero from a duration
+  text,      // whatever show_text() was last given, on the digit panels
+};
+
 class clock {
 public:
   static auto get() -> clock & {
@@ -21,7 +44,34 @@ public:
   }
 
   void update();
+  // Shows time rather than the time now
+  void update(const struct tm &time);
+  // Whether any panel is still flipping or waiting to
+  bool flipping() const;
+  // Looks ahead to the next minute or shows it, whichever is due
+  void minute_timer();
+  void fast_timer();
+  // countdown_ms is where the countdown starts from
+  void set_mode(clock_mode mode, uint32_t countdown_ms = 0);
+  const digit_ticker_stats &ticker_stats(size_t panel) const;
+  void reset_ticker_stats();
+  // Flips the digit panels to symbols, in text mode
+  void show_text(const std::array<uint8_t, CLOCK_DIGIT_PANELS> &symbols);
+  // What a digit panel shows, or is flipping to
+  uint8_t digit_shown(size_t panel) const {
+    return digit_panels[panel].sequence.value();
+  }
+  // From the last minute turning over to the first frame of its first flip
+  // that moves being drawn, once one has been
+  uint32_t boundary_latency_ms() const { return boundary_latency; }
   void shuffle();
+  // How the digit panels get from one value to the next from now on
+  void set_transition(transition_kernel kernel) { transition = kernel; }
+  const flapper_frame_stats &frame_stats(size_t panel) const {
+    return flappers[panel]->frame_stats();
+  }
+  flip_scheduler &scheduler() { return flip_scheduler_; }
+  digit_ticker &ticker(size_t panel) { return *tickers[panel]; }
 
   clock(clock const &) = delete;
   void operator=(const clock &) = delete;
@@ -32,12 +82,60 @@ public:
 private:
   clock();
 
+  // every flapper can hold a before and an after snapshot at once, allocated
+  // only if one ever snapshots the screen
+  snapshot_pool snapshots{NUM_LCDS * 2,
+                          LCD_WIDTH * LCD_HEIGHT * sizeof(lv_color_t)};
+  // the rows flips read most, in internal RAM for the two digit panels that
+  // are flipping at once at most, if it can spare them. Half a face each,
+  // 27 KB in all, and only taken with the 64 KB spiram_allocate_internal()
+  // keeps back for WiFi and the draw buffers still free besides.
+  snapshot_pool hot_rows{2, FLAPPER_HOT_ROWS_SIZE, true};
+  sprite_atlas sprites{NUM_SPRITES, SPRITE_IMAGE_SIZE};
+  flip_scheduler flip_scheduler_;
   std::array<lv_obj_t *, NUM_LCDS> background_images{};
   std::array<lv_obj_t *, NUM_LCDS-1> digit_labels{};
   std::array<flapper *, NUM_LCDS> flappers{};
-  std::array<std::unique_ptr<flap_sequence>, NUM_LCDS-1> flap_sequences{};
-  std::array<lv_timer_t *, NUM_LCDS-1> delayed_start_timers{};
+  std::array<digit_ticker *, NUM_LCDS> tickers{};
+  clock_mode mode{clock_mode::time};
+  uint32_t mode_start_ms{};
+  uint32_t countdown_ms{};
+  lv_timer_t *fast_update_timer;
+
+  // Everything a digit panel's flips need, for as long as the clock lives
+  struct digit_panel {
+    class clock *owner;
+    size_t index;
+    flap_sequence sequence;
+    uint8_t shown; // symbol the label shows
+    bool pending;  // sequence is set and waiting for commit()
+  };
+  std::array<digit_panel, CLOCK_DIGIT_PANELS> digit_panels{};
+
+  transition_kernel transition{transition_flip};
   lv_obj_t *ampm_label_top, *ampm_label_bottom;
+  uint8_t ampm_shown{CLOCK_BLANK};
+  // the symbols either side of the AM/PM flip
+  uint8_t ampm_from{CLOCK_BLANK}, ampm_to{CLOCK_BLANK};
+  bool ampm_pending{false};
   lv_timer_t *clock_update_timer;
-  void delayed_start_flap_sequence(size_t index);
+  // set up ahead of the minute, waiting for it to turn over
+  bool prepared{false};
+  size_t first_changed_panel{NUM_LCDS};
+  // when the last minute turned over, in LVGL ticks, and the panel whose
+  // first frame it is timed to; NUM_LCDS once measured or if not timed
+  uint32_t boundary_tick{};
+  size_t boundary_panel{NUM_LCDS};
+  uint32_t boundary_latency{};
+  void prepare(const struct tm &time);
+  void commit();
+  void wait_for_minute(uint32_t remaining_ms);
+  void watch_boundary();
+  void build_sprites();
+  void render_sprites();
+  void set_digit(size_t index, uint8_t symbol);
+  void set_ampm_labels(uint8_t symbol);
+  void flip_ampm();
+  const lv_img_dsc_t *digit_sprite(uint8_t symbol) const;
+  const lv_img_dsc_t *ampm_sprite(uint8_t symbol) const;
 };
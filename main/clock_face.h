@@ -0,0 +1,109 @@
+//   SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//   SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+
+// What the clock's panels show, as indices into constant symbol tables
+// rather than strings, so working out the next minute's flips allocates
+// nothing. A digit symbol's index is also its sprite's.
+
+constexpr size_t CLOCK_DIGIT_PANELS = 5;
+// Most flips a panel makes to get from one symbol to another
+constexpr size_t CLOCK_MAX_STEPS = 12;
+
+constexpr uint8_t CLOCK_BLANK = 0;
+constexpr uint8_t CLOCK_COLON = 1;
+constexpr uint8_t CLOCK_DIGIT_0 = 2;
+
+constexpr std::array<const char *, 12> CLOCK_DIGIT_SYMBOLS = {
+    "", ":", "0", "1", "2", "3", "4", "5", "6", "7", "8", "9"};
+
+// Letters the digit font also has, for text. Their symbols follow the
+// digits', and so do their sprites.
+constexpr uint8_t CLOCK_LETTER_A = 12;
+
+constexpr std::array<const char *, 16> CLOCK_LETTER_SYMBOLS = {
+    "A", "B", "C", "D", "E", "F", "G", "H",
+    "I", "J", "K", "L", "M", "N", "O", "P"};
+
+// The symbol showing c on a digit panel, in either case; blank for anything
+// the font doesn't have
+constexpr uint8_t clock_text_symbol(char c) {
+  if (c >= 'a' && c <= 'z') {
+    c = static_cast<char>(c - 'a' + 'A');
+  }
+  if (c >= '0' && c <= '9') {
+    return static_cast<uint8_t>(CLOCK_DIGIT_0 + (c - '0'));
+  }
+  if (c == ':') {
+    return CLOCK_COLON;
+  }
+  if (c >= 'A' && c < 'A' + static_cast<int>(CLOCK_LETTER_SYMBOLS.size())) {
+    return static_cast<uint8_t>(CLOCK_LETTER_A + (c - 'A'));
+  }
+  return CLOCK_BLANK;
+}
+
+// The order the digit panels flip through symbols in, wrapping around
+constexpr std::array<uint8_t, 12> CLOCK_DIGITS_LOOP = {0, 1, 2, 3, 4,  5,
+                                                       6, 7, 8, 9, 10, 11};
+constexpr std::array<uint8_t, 2> CLOCK_DIVIDER_LOOP = {CLOCK_BLANK,
+                                                       CLOCK_COLON};
+
+// The last panel shows its letter over an M, or nothing
+constexpr uint8_t CLOCK_AM = 1;
+constexpr uint8_t CLOCK_PM = 2;
+
+constexpr std::array<const char *, 3> CLOCK_AMPM_SYMBOLS = {"", "A", "P"};
+
+struct clock_face {
+  std::array<uint8_t, CLOCK_DIGIT_PANELS> digits;
+  uint8_t ampm;
+};
+
+// What strftime's "%I:%M%p" would show, without formatting it
+constexpr clock_face clock_face_at(const struct tm &time) {
+  int hour = time.tm_hour % 12 == 0 ? 12 : time.tm_hour % 12;
+  return {.digits = {static_cast<uint8_t>(CLOCK_DIGIT_0 + hour / 10),
+                     static_cast<uint8_t>(CLOCK_DIGIT_0 + hour % 10),
+                     CLOCK_COLON,
+                     static_cast<uint8_t>(CLOCK_DIGIT_0 + time.tm_min / 10),
+                     static_cast<uint8_t>(CLOCK_DIGIT_0 + time.tm_min % 10)},
+          .ampm = time.tm_hour < 12 ? CLOCK_AM : CLOCK_PM};
+}
+
+// Fills steps with every symbol a panel shows going around loop from one
+// symbol to another, ending on it, and returns how many; 0 if either isn't
+// in the loop
+template <size_t N>
+constexpr size_t clock_steps(const std::array<uint8_t, N> &loop, uint8_t from,
+                             uint8_t to,
+                             std::array<uint8_t, CLOCK_MAX_STEPS> &steps) {
+  static_assert(N <= CLOCK_MAX_STEPS);
+  size_t start = N;
+  size_t end = N;
+  for (size_t i = 0; i < N; i++) {
+    if (loop[i] == from) {
+      start = i;
+    }
+    if (loop[i] == to) {
+      end = i;
+    }
+  }
+  if (start == N || end == N) {
+    return 0;
+  }
+
+  size_t count = 0;
+  size_t i = start;
+  do {
+    i = (i + 1) % N;
+    steps[count++] = loop[i];
+  } while (i != end);
+  return count;
+}
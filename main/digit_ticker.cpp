@@ -0,0 +1,202 @@
+//   SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//   SPDX-License-Identifier: MIT
+
+#include "digit_ticker.h"
+#include "glyph_cache.h"
+
+#include <algorithm>
+
+digit_ticker::digit_ticker(lv_obj_t *screen, const lv_area_t &area,
+                           const lv_font_t *font, lv_color_t color,
+                           flip_scheduler *scheduler, size_t panel)
+    : screen(screen), font(font), color(color), scheduler(scheduler),
+      panel(panel) {
+  window = lv_obj_create(screen);
+  // Transparent, so LVGL draws the textured face under it each frame and the
+  // letters' edges blend into that rather than into a flat patch of color
+  lv_obj_remove_style_all(window);
+  lv_obj_add_event_cb(
+      window,
+      [](lv_event_t *event) {
+        static_cast<digit_ticker *>(lv_event_get_user_data(event))
+            ->draw(event);
+      },
+      LV_EVENT_DRAW_MAIN, this);
+  lv_obj_set_pos(window, area.x1, area.y1);
+  lv_obj_set_size(window, lv_area_get_width(&area),
+                  lv_area_get_height(&area));
+  lv_obj_add_flag(window, LV_OBJ_FLAG_HIDDEN);
+  progress = lv_area_get_height(&area);
+
+  // Made once and paused between slides, where lv_anim would allocate for
+  // every step
+  slide_timer = lv_timer_create(
+      [](lv_timer_t *timer) {
+        static_cast<digit_ticker *>(timer->user_data)->step();
+      },
+      LV_DISP_DEF_REFR_PERIOD, this);
+  lv_timer_pause(slide_timer);
+  lv_anim_init(&path);
+  lv_anim_set_path_cb(&path, lv_anim_path_ease_out);
+}
+
+digit_ticker::~digit_ticker() {
+  scheduler->cancel(panel);
+  stop_slide();
+  lv_timer_del(slide_timer);
+  lv_obj_del(window);
+}
+
+void digit_ticker::show(bool visible) {
+  if (visible) {
+    lv_obj_clear_flag(window, LV_OBJ_FLAG_HIDDEN);
+    return;
+  }
+
+  // comes back blank
+  scheduler->cancel(panel);
+  waiting = false;
+  stop_slide();
+  from_letter = to_letter = 0;
+  lv_obj_add_flag(window, LV_OBJ_FLAG_HIDDEN);
+}
+
+void digit_ticker::set(uint32_t letter, uint32_t duration_ms) {
+  if (letter == (waiting ? next_letter : to_letter)) {
+    return;
+  }
+
+  if (waiting || sliding) {
+    stats_.late_steps++;
+  }
+  stop_slide(); // a slide still going jumps to its end
+
+  stats_.steps++;
+  next_letter = letter;
+  next_duration_ms = duration_ms;
+  requested_ms = lv_tick_get();
+  waiting = true;
+  scheduler->request(
+      panel, step_bus_bytes(duration_ms),
+      [](void *user_data) {
+        static_cast<digit_ticker *>(user_data)->start_step();
+      },
+      this);
+}
+
+// The window's worth of pixels for every display refresh the slide spans
+uint32_t digit_ticker::step_bus_bytes(uint32_t duration_ms) const {
+  uint32_t frames = duration_ms / LV_DISP_DEF_REFR_PERIOD + 1;
+  return frames * lv_obj_get_width(window) * lv_obj_get_height(window) *
+         sizeof(lv_color_t);
+}
+
+void digit_ticker::start_step() {
+  waiting = false;
+  from_letter = to_letter;
+  to_letter = next_letter;
+  last_frame_ms = lv_tick_get();
+
+  lv_coord_t height = lv_obj_get_height(window);
+  if (next_duration_ms == 0) {
+    animate(height);
+    step_finished();
+    return;
+  }
+
+  lv_anim_set_time(&path, next_duration_ms);
+  lv_anim_set_values(&path, 0, height);
+  slide_start_ms = lv_tick_get();
+  sliding = true;
+  // the first frame goes out now, the rest once a display refresh
+  animate(0);
+  lv_timer_reset(slide_timer);
+  lv_timer_resume(slide_timer);
+}
+
+void digit_ticker::step() {
+  path.act_time = static_cast<int32_t>(
+      std::min<uint32_t>(lv_tick_elaps(slide_start_ms), path.time));
+  animate(path.path_cb(&path));
+  if (path.act_time == path.time) {
+    stop_slide();
+  }
+}
+
+void digit_ticker::stop_slide() {
+  if (!sliding) {
+    return;
+  }
+  lv_timer_pause(slide_timer);
+  step_finished();
+}
+
+void digit_ticker::animate(int32_t value) {
+  uint32_t frame_ms = lv_tick_elaps(last_frame_ms);
+  last_frame_ms = lv_tick_get();
+  stats_.frames++;
+  stats_.max_frame_ms = std::max(stats_.max_frame_ms, frame_ms);
+
+  progress = value;
+  lv_obj_invalidate(window);
+}
+
+void digit_ticker::step_finished() {
+  sliding = false;
+  lv_coord_t height = lv_obj_get_height(window);
+  if (progress != height) { // cut short, jump to the end
+    progress = height;
+    lv_obj_invalidate(window);
+  }
+  stats_.max_step_ms =
+      std::max(stats_.max_step_ms, lv_tick_elaps(requested_ms));
+}
+
+// The face is already drawn underneath; the letter sliding out goes up ahead
+// of the one sliding in
+void digit_ticker::draw(lv_event_t *event) {
+  auto *draw_ctx = lv_event_get_draw_ctx(event);
+
+  lv_area_t window_area, clip_area;
+  lv_obj_get_coords(window, &window_area);
+  if (!_lv_area_intersect(&clip_area, draw_ctx->clip_area, &window_area)) {
+    return;
+  }
+
+  lv_coord_t height = lv_area_get_height(&window_area);
+  blit(from_letter, (lv_coord_t)(window_area.y1 - progress), clip_area,
+       draw_ctx);
+  blit(to_letter, (lv_coord_t)(window_area.y1 + height - progress), clip_area,
+       draw_ctx);
+}
+
+void digit_ticker::blit(uint32_t letter, lv_coord_t y, const lv_area_t &clip,
+                        lv_draw_ctx_t *draw_ctx) {
+  if (letter == 0) {
+    return;
+  }
+  // where a label holding just the letter, centred on the screen, puts it
+  lv_area_t screen_area;
+  lv_obj_get_coords(screen, &screen_area);
+  lv_coord_t x = screen_area.x1 + lv_area_get_width(&screen_area) / 2 -
+                 lv_font_get_glyph_width(font, letter, 0) / 2;
+
+  lv_point_t offset;
+  const glyph_tile *tile = glyph_cache_tile(font, letter, color, &offset);
+  if (tile == nullptr) {
+    // no tile, out of PSRAM or slots, so LVGL draws it, inside the window
+    lv_draw_label_dsc_t label;
+    lv_draw_label_dsc_init(&label);
+    label.font = font;
+    label.color = color;
+    lv_point_t pos = {x, y};
+    const lv_area_t *event_clip = draw_ctx->clip_area;
+    draw_ctx->clip_area = &clip;
+    lv_draw_letter(draw_ctx, &label, &pos, letter);
+    draw_ctx->clip_area = event_clip;
+    return;
+  }
+
+  glyph_cache_blit(*tile, (lv_coord_t)(x + offset.x),
+                   (lv_coord_t)(y + offset.y), clip, draw_ctx);
+}
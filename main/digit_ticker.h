@@ -0,0 +1,81 @@
+//   SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//   SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <lvgl.h>
+
+#include "flip_scheduler.h"
+#include "glyph_tile.h"
+
+struct digit_ticker_stats {
+  uint32_t steps;        // digits changed
+  uint32_t frames;       // animation frames handed to LVGL to draw
+  uint32_t late_steps;   // steps still waiting or sliding when the next came
+  uint32_t max_step_ms;  // longest from a step being asked for to its end
+  uint32_t max_frame_ms; // longest between two frames of a step
+};
+
+// The fast path for digits that change faster than a flap can fall: a
+// window over the panel's digit, below its divider, that slides one cached
+// glyph tile out and the next in, blended straight into LVGL's buffer over
+// the face drawn underneath. No snapshots, no sprites and no label drawn,
+// and only the window is sent.
+class digit_ticker {
+public:
+  // Draws letters in font and color over area of screen, where a label
+  // centred across the screen and as tall as the area would put them.
+  // Created hidden, and under whatever is created on screen after it.
+  digit_ticker(lv_obj_t *screen, const lv_area_t &area, const lv_font_t *font,
+               lv_color_t color, flip_scheduler *scheduler, size_t panel);
+  ~digit_ticker();
+
+  digit_ticker(digit_ticker const &) = delete;
+  void operator=(const digit_ticker &) = delete;
+
+  void show(bool visible);
+  // Slides letter in over duration_ms once the scheduler admits it, or cuts
+  // to it with 0; 0 for letter leaves the window blank
+  void set(uint32_t letter, uint32_t duration_ms);
+  // Bytes a step of duration_ms is expected to send the panel
+  uint32_t step_bus_bytes(uint32_t duration_ms) const;
+  // Whether a slide is under way
+  bool moving() const { return sliding; }
+
+  const digit_ticker_stats &stats() const { return stats_; }
+  void reset_stats() { stats_ = {}; }
+
+private:
+  void start_step();
+  void step();
+  void stop_slide();
+  void animate(int32_t value);
+  void step_finished();
+  void draw(lv_event_t *event);
+  void blit(uint32_t letter, lv_coord_t y, const lv_area_t &clip,
+            lv_draw_ctx_t *draw_ctx);
+
+  lv_obj_t *screen;
+  lv_obj_t *window;
+  const lv_font_t *font;
+  lv_color_t color;
+  flip_scheduler *scheduler;
+  size_t panel;
+  lv_timer_t *slide_timer;
+  // Only ever evaluated, for how far a slide is after act_time
+  lv_anim_t path{};
+
+  uint32_t from_letter{};
+  uint32_t to_letter{};
+  uint32_t next_letter{};
+  uint32_t next_duration_ms{};
+  int32_t progress{};
+  bool waiting{};
+  bool sliding{};
+  uint32_t requested_ms{};
+  uint32_t slide_start_ms{};
+  uint32_t last_frame_ms{};
+  digit_ticker_stats stats_{};
+};
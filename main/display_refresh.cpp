@@ -0,0 +1,39 @@
+//  SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//  SPDX-License-Identifier: MIT
+
+#include "display_refresh.h"
+
+static void refresh_timer(lv_timer_t *timer) {
+  _lv_disp_refr_timer(timer);
+  auto *display = static_cast<lv_disp_t *>(timer->user_data);
+  if (display->inv_p == 0) {
+    lv_timer_pause(timer);
+  }
+}
+
+void display_refresh_install(lv_disp_t *display) {
+  lv_timer_set_cb(display->refr_timer, refresh_timer);
+}
+
+// Whether any display with a paused refresh has been invalidated since
+static bool resume_invalidated() {
+  bool resumed = false;
+  for (lv_disp_t *display = lv_disp_get_next(nullptr); display != nullptr;
+       display = lv_disp_get_next(display)) {
+    if (display->inv_p > 0 && display->refr_timer->paused) {
+      lv_timer_resume(display->refr_timer);
+      resumed = true;
+    }
+  }
+  return resumed;
+}
+
+// The pass over again rather than a sleep, so a frame invalidated by a timer
+// that ran after the refresh still goes out now
+uint32_t display_refresh_timer_handler() {
+  uint32_t sleep_ms;
+  do {
+    sleep_ms = lv_timer_handler();
+  } while (resume_invalidated());
+  return sleep_ms;
+}
@@ -0,0 +1,21 @@
+//  SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//  SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <lvgl.h>
+
+// LVGL runs every display's refresh timer each LV_DISP_DEF_REFR_PERIOD
+// whether anything changed or not, which would wake the GUI task 33 times a
+// second for nothing. Installed on a display, a refresh that leaves nothing
+// to draw pauses its timer, and display_refresh_timer_handler() resumes it
+// once something on the display is invalidated again.
+//
+// Relies on LVGL 8.3 internals: _lv_disp_refr_timer() is the refresh
+// timer's own callback, and lv_disp_t::inv_p counts the areas invalidated
+// since the last refresh, which that callback sets back to 0.
+void display_refresh_install(lv_disp_t *display);
+
+// lv_timer_handler(), passed over again for any display invalidated while
+// its refresh was paused. Returns how long until a timer is next due.
+uint32_t display_refresh_timer_handler();
@@ -0,0 +1,91 @@
+//  SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//  SPDX-License-Identifier: MIT
+
+#include "cache_partition.h"
+
+#include <esp_app_desc.h>
+#include <esp_log.h>
+#include <esp_partition.h>
+
+#include <cstring>
+
+constexpr auto TAG = "cache_partition";
+constexpr auto CACHE_PARTITION_LABEL = "flipcache";
+
+static const esp_partition_t *partition = nullptr;
+static bool partition_looked_up = false;
+static const void *mapped = nullptr;
+static esp_partition_mmap_handle_t map_handle;
+
+static const esp_partition_t *find_partition() {
+  if (!partition_looked_up) {
+    partition = esp_partition_find_first(
+        ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+        CACHE_PARTITION_LABEL);
+    partition_looked_up = true;
+    if (partition == nullptr) {
+      ESP_LOGW(TAG, "no %s partition, flips will be rendered live",
+               CACHE_PARTITION_LABEL);
+    }
+  }
+  return partition;
+}
+
+static void unmap() {
+  if (mapped != nullptr) {
+    esp_partition_munmap(map_handle);
+    mapped = nullptr;
+  }
+}
+
+size_t cache_partition_size() {
+  const esp_partition_t *found = find_partition();
+  return found != nullptr ? found->size : 0;
+}
+
+const uint8_t *cache_partition_map(size_t size) {
+  const esp_partition_t *found = find_partition();
+  if (found == nullptr || size > found->size) {
+    return nullptr;
+  }
+
+  unmap();
+  esp_err_t err = esp_partition_mmap(found, 0, size, ESP_PARTITION_MMAP_DATA,
+                                     &mapped, &map_handle);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "mapping %u bytes failed: %s", size, esp_err_to_name(err));
+    mapped = nullptr;
+    return nullptr;
+  }
+  return static_cast<const uint8_t *>(mapped);
+}
+
+bool cache_partition_erase(size_t size) {
+  const esp_partition_t *found = find_partition();
+  if (found == nullptr) {
+    return false;
+  }
+
+  size_t rounded =
+      (size + found->erase_size - 1) / found->erase_size * found->erase_size;
+  if (rounded > found->size) {
+    return false;
+  }
+
+  unmap(); // nothing may read the range while it is rewritten
+  ESP_LOGI(TAG, "erasing %u bytes", rounded);
+  return esp_partition_erase_range(found, 0, rounded) == ESP_OK;
+}
+
+bool cache_partition_write(size_t offset, const void *data, size_t size) {
+  const esp_partition_t *found = find_partition();
+  return found != nullptr &&
+         esp_partition_write(found, offset, data, size) == ESP_OK;
+}
+
+void cache_partition_build_id(uint8_t id[CACHE_PARTITION_BUILD_ID_SIZE]) {
+  static_assert(sizeof(esp_app_desc_t::app_elf_sha256) ==
+                CACHE_PARTITION_BUILD_ID_SIZE);
+  memcpy(id, esp_app_get_description()->app_elf_sha256,
+         CACHE_PARTITION_BUILD_ID_SIZE);
+}
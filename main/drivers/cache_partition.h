@@ -0,0 +1,27 @@
+//  SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//  SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// The raw "flipcache" data partition prerendered flip assets are kept in.
+// drivers/cache_partition.cpp goes through esp_partition; the simulator keeps
+// it in memory, so every simulator run starts out with an empty cache.
+
+constexpr size_t CACHE_PARTITION_BUILD_ID_SIZE = 32;
+
+// 0 when the partition table has no such partition
+size_t cache_partition_size();
+
+// Maps the first `size` bytes read only. The mapping stays valid until the
+// next map or erase.
+const uint8_t *cache_partition_map(size_t size);
+
+// Erases at least the first `size` bytes, ready to be written
+bool cache_partition_erase(size_t size);
+bool cache_partition_write(size_t offset, const void *data, size_t size);
+
+// Identifies the firmware build, so assets another build rendered are redone
+void cache_partition_build_id(uint8_t id[CACHE_PARTITION_BUILD_ID_SIZE]);
@@ -0,0 +1,227 @@
+//  SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//  SPDX-License-Identifier: MIT
+
+#include "lcd_bus.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <driver/gpio.h>
+#include <driver/spi_master.h>
+#include <esp_log.h>
+#include <rom/ets_sys.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+// shared constants
+constexpr auto CONFIG_MOSI_GPIO = GPIO_NUM_13;
+constexpr auto CONFIG_SCLK_GPIO = GPIO_NUM_12;
+constexpr auto CONFIG_GPIO_DC = GPIO_NUM_14;
+constexpr auto CONFIG_GPIO_RESET = GPIO_NUM_27;
+constexpr auto CONFIG_GPIO_BL = GPIO_NUM_19;
+
+// unique constants per display
+/*
+  LCD1 CS pin     33
+  LCD2 CS pin     26
+  LCD3 CS pin     21
+  LCD4 CS pin     0
+  LCD5 CS pin     5
+  LCD6 CS pin     18
+ */
+
+constexpr gpio_num_t GPIO_CS_PINS[NUM_LCDS] = {
+    GPIO_NUM_33, GPIO_NUM_26, GPIO_NUM_21, GPIO_NUM_0, GPIO_NUM_5, GPIO_NUM_18};
+constexpr auto TAG = "lcd_bus";
+
+// Transactions that can be queued on the bus at once. A blit is six (CASET,
+// RASET and RAMWR each as command + data) plus any extra pixel chunks.
+constexpr size_t LCD_SPI_QUEUE_SIZE = 16;
+
+// Everything the transfer callbacks need to know about a queued transaction.
+// The chip select mask travels with the transaction because lcd_select() may
+// already have moved on by the time the bus gets to it.
+struct queued_transaction {
+  spi_transaction_t transaction;
+  uint8_t dc;
+  uint8_t cs_mask;
+  lcd_blit_done_cb done_cb;
+  void *done_user_data;
+};
+
+// One SPI device shared by all panels. Chip select is driven by hand from
+// GPIO_CS_PINS so switching panels is a pair of GPIO writes instead of a
+// remove/add device reconfiguration. The panels only listen (MISO is not
+// connected), so any number of them can be selected at once to receive the
+// same bytes.
+static spi_device_handle_t spi_device_handle = nullptr;
+static volatile uint8_t asserted_mask = 0; // as seen by the bus
+static lcd_bus_stats bus_stats{};
+
+// Ring of transaction slots. Results come back in queue order on a single
+// device, so the oldest in-flight slot is always next_transaction -
+// transactions_in_flight.
+static queued_transaction transaction_pool[LCD_SPI_QUEUE_SIZE];
+static size_t next_transaction = 0;
+static size_t transactions_in_flight = 0;
+
+static void lcd_spi_pre_transfer_cb(spi_transaction_t *t) {
+  const auto *queued = static_cast<const queued_transaction *>(t->user);
+
+  // CS is active low; release panels leaving the set before asserting the
+  // ones joining it
+  uint8_t changed = queued->cs_mask ^ asserted_mask;
+  if (changed != 0) {
+    for (size_t i = 0; i < NUM_LCDS; i++) {
+      if ((changed & asserted_mask) & (1 << i)) {
+        gpio_set_level(GPIO_CS_PINS[i], 1);
+      }
+    }
+    for (size_t i = 0; i < NUM_LCDS; i++) {
+      if ((changed & queued->cs_mask) & (1 << i)) {
+        gpio_set_level(GPIO_CS_PINS[i], 0);
+      }
+    }
+    asserted_mask = queued->cs_mask;
+  }
+
+  gpio_set_level(CONFIG_GPIO_DC, queued->dc);
+}
+
+static void lcd_spi_post_transfer_cb(spi_transaction_t *t) {
+  const auto *queued = static_cast<const queued_transaction *>(t->user);
+  if (queued->done_cb != nullptr) {
+    queued->done_cb(queued->done_user_data);
+  }
+}
+
+void lcd_bus_init() {
+  assert(spi_device_handle == nullptr);
+
+  ESP_LOGI(TAG, "Configuring LCD SPI devices");
+
+  for (auto pin : GPIO_CS_PINS) {
+    gpio_reset_pin(pin);
+    gpio_set_direction(pin, GPIO_MODE_OUTPUT);
+    gpio_set_level(pin, 1);
+  }
+  asserted_mask = 0;
+
+  gpio_reset_pin(CONFIG_GPIO_RESET);
+  gpio_set_direction(CONFIG_GPIO_RESET, GPIO_MODE_OUTPUT);
+  gpio_set_level(CONFIG_GPIO_RESET, 1);
+
+  gpio_reset_pin(CONFIG_GPIO_DC);
+  gpio_set_direction(CONFIG_GPIO_DC, GPIO_MODE_OUTPUT);
+  gpio_set_level(CONFIG_GPIO_DC, 0);
+
+  gpio_reset_pin(CONFIG_GPIO_BL);
+  gpio_set_direction(CONFIG_GPIO_BL, GPIO_MODE_OUTPUT);
+  lcd_bus_set_backlight(false);
+
+  spi_bus_config_t bus_config = {.mosi_io_num = CONFIG_MOSI_GPIO,
+                                 .miso_io_num = -1,
+                                 .sclk_io_num = CONFIG_SCLK_GPIO,
+                                 .quadwp_io_num = -1,
+                                 .quadhd_io_num = -1,
+                                 .max_transfer_sz = LCD_SPI_MAX_TRANSFER_SIZE};
+
+  ESP_ERROR_CHECK(spi_bus_initialize(SPI2_HOST, &bus_config, SPI_DMA_CH_AUTO));
+
+  spi_device_interface_config_t tft_devcfg = {
+      .clock_speed_hz = LCD_BUS_CLOCK_HZ,
+      .spics_io_num = -1, // driven manually, see lcd_spi_pre_transfer_cb()
+      .flags = SPI_DEVICE_NO_DUMMY,
+      .queue_size = LCD_SPI_QUEUE_SIZE,
+      .pre_cb = lcd_spi_pre_transfer_cb,
+      .post_cb = lcd_spi_post_transfer_cb,
+  };
+  ESP_ERROR_CHECK(
+      spi_bus_add_device(SPI2_HOST, &tft_devcfg, &spi_device_handle));
+  bus_stats.bus_reconfigurations++;
+
+  // we are the only device on this bus, so keep it for good
+  ESP_ERROR_CHECK(spi_device_acquire_bus(spi_device_handle, portMAX_DELAY));
+}
+
+void lcd_bus_hardware_reset() {
+  gpio_set_level(CONFIG_GPIO_RESET, 0);
+  vTaskDelay(pdMS_TO_TICKS(100));
+  gpio_set_level(CONFIG_GPIO_RESET, 1);
+}
+
+// the backlight enable is active low
+void lcd_bus_set_backlight(bool on) { gpio_set_level(CONFIG_GPIO_BL, !on); }
+
+static void reclaim_oldest_transaction() {
+  assert(transactions_in_flight > 0);
+
+  spi_transaction_t *result = nullptr;
+  ESP_ERROR_CHECK(
+      spi_device_get_trans_result(spi_device_handle, &result, portMAX_DELAY));
+  transactions_in_flight--;
+}
+
+void lcd_bus_wait_idle() {
+  while (transactions_in_flight > 0) {
+    reclaim_oldest_transaction();
+  }
+}
+
+void lcd_bus_delay_us(uint32_t delay_us) { ets_delay_us(delay_us); }
+
+void lcd_bus_queue(uint8_t cs_mask, uint8_t dc, const uint8_t *data,
+                   size_t length, lcd_blit_done_cb done_cb,
+                   void *done_user_data) {
+  assert(cs_mask != 0);
+
+  while (length > 0) {
+    size_t this_send_length = std::min(length, LCD_SPI_MAX_TRANSFER_SIZE);
+    bool last = this_send_length == length;
+
+    if (transactions_in_flight == LCD_SPI_QUEUE_SIZE) {
+      reclaim_oldest_transaction();
+    }
+
+    queued_transaction &queued = transaction_pool[next_transaction];
+    next_transaction = (next_transaction + 1) % LCD_SPI_QUEUE_SIZE;
+
+    queued = {
+        .transaction = {.length = this_send_length * 8},
+        .dc = dc,
+        .cs_mask = cs_mask,
+        .done_cb = last ? done_cb : nullptr,
+        .done_user_data = last ? done_user_data : nullptr,
+    };
+    queued.transaction.user = &queued;
+
+    if (this_send_length <= sizeof(queued.transaction.tx_data)) {
+      queued.transaction.flags = SPI_TRANS_USE_TXDATA;
+      memcpy(queued.transaction.tx_data, data, this_send_length);
+    } else {
+      queued.transaction.tx_buffer = data;
+    }
+
+    ESP_ERROR_CHECK(spi_device_queue_trans(spi_device_handle,
+                                           &queued.transaction, portMAX_DELAY));
+    transactions_in_flight++;
+    bus_stats.transactions++;
+    bus_stats.bytes += this_send_length;
+    if ((cs_mask & (cs_mask - 1)) != 0) {
+      bus_stats.broadcast_transactions++;
+    }
+
+    length -= this_send_length;
+    data += this_send_length;
+  }
+}
+
+void lcd_bus_collect_stats(lcd_bus_stats *stats) {
+  stats->bus_reconfigurations = bus_stats.bus_reconfigurations;
+  stats->transactions = bus_stats.transactions;
+  stats->broadcast_transactions = bus_stats.broadcast_transactions;
+  stats->bytes = bus_stats.bytes;
+}
+
+void lcd_bus_reset_stats() { bus_stats = {}; }
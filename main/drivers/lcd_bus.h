@@ -0,0 +1,33 @@
+//  SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//  SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "lcds.h"
+
+// Byte transport underneath lcds.cpp: the shared MOSI/SCK/DC lines, the six
+// chip selects, reset and backlight. drivers/lcd_bus.cpp drives the real SPI
+// peripheral; the simulator links an ST7735 emulator in its place.
+
+constexpr uint32_t LCD_BUS_CLOCK_HZ = 40 * 1000 * 1000;
+
+void lcd_bus_init();
+void lcd_bus_hardware_reset();
+void lcd_bus_set_backlight(bool on);
+
+// Queues bytes to every panel in cs_mask with the D/C line at `dc`. Up to four
+// bytes are copied; anything longer must stay valid until the transfer
+// completes. done_cb, if any, runs (possibly from an interrupt) once the last
+// byte is out.
+void lcd_bus_queue(uint8_t cs_mask, uint8_t dc, const uint8_t *data,
+                   size_t length, lcd_blit_done_cb done_cb = nullptr,
+                   void *done_user_data = nullptr);
+void lcd_bus_wait_idle();
+void lcd_bus_delay_us(uint32_t delay_us);
+
+// Fills in the transport's share of lcd_bus_stats
+void lcd_bus_collect_stats(lcd_bus_stats *stats);
+void lcd_bus_reset_stats();
@@ -0,0 +1,190 @@
+//  SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//  SPDX-License-Identifier: MIT
+
+#include "lcd_shadow.h"
+#include "spiram_allocate.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+static uint16_t *shadows[NUM_LCDS];
+static uint8_t valid_mask = 0; // panels whose shadow matches their GRAM
+static lcd_shadow_stats stats{};
+
+// A run of strip rows sharing the same dirty columns, in strip coordinates
+struct dirty_window {
+  size_t column_start;
+  size_t column_end; // exclusive
+  size_t row_start;
+  size_t row_end; // exclusive
+};
+
+// The previous window is only queued once the next one is known, so the
+// caller's done_cb can ride on whichever turns out to be last.
+struct pending_send {
+  size_t x, y;
+  size_t w, h;
+  uint16_t *pixels;
+  bool valid;
+};
+
+void lcd_shadow_init() {
+  assert(shadows[0] == nullptr);
+
+  for (auto &shadow : shadows) {
+    shadow = static_cast<uint16_t *>(
+        spiram_allocate(LCD_WIDTH * LCD_HEIGHT * sizeof(uint16_t)));
+    assert(shadow != nullptr);
+  }
+  valid_mask = 0;
+}
+
+bool lcd_shadow_enabled() { return shadows[0] != nullptr; }
+
+void lcd_shadow_invalidate(uint8_t mask) { valid_mask &= ~mask; }
+
+// Compares one tile of the strip with each shadow in mask and brings the
+// shadows up to date. Returns whether any of them differed.
+static bool update_tile(uint8_t mask, size_t x, size_t y, size_t w,
+                        const uint16_t *pixels, size_t column, size_t row,
+                        size_t tile_w, size_t tile_h) {
+  bool dirty = (mask & valid_mask) != mask;
+  size_t row_bytes = tile_w * sizeof(uint16_t);
+
+  for (size_t i = 0; i < NUM_LCDS; i++) {
+    if ((mask & (1 << i)) == 0) {
+      continue;
+    }
+
+    for (size_t r = row; r < row + tile_h; r++) {
+      const uint16_t *source = &pixels[r * w + column];
+      uint16_t *shadow = &shadows[i][(y + r) * LCD_WIDTH + x + column];
+
+      stats.psram_bytes += row_bytes;
+      if (memcmp(shadow, source, row_bytes) != 0) {
+        memcpy(shadow, source, row_bytes);
+        stats.psram_bytes += row_bytes;
+        dirty = true;
+      }
+    }
+  }
+
+  return dirty;
+}
+
+// Moves a window's pixels to the front of what is left of the strip so they
+// can go out as one contiguous transfer. Windows are visited top to bottom
+// with one column range per row band, so the destination never overtakes a
+// source that is still to be read.
+static uint16_t *compact_window(uint16_t *pixels, size_t w,
+                                const dirty_window &window, uint16_t **out) {
+  size_t window_w = window.column_end - window.column_start;
+  uint16_t *start = *out;
+
+  for (size_t r = window.row_start; r < window.row_end; r++) {
+    const uint16_t *source = &pixels[r * w + window.column_start];
+    if (source != *out) {
+      memmove(*out, source, window_w * sizeof(uint16_t));
+    }
+    *out += window_w;
+  }
+
+  return start;
+}
+
+static void send(pending_send *pending, lcd_blit_done_cb done_cb,
+                 void *user_data) {
+  if (!pending->valid) {
+    return;
+  }
+
+  size_t bytes = pending->w * pending->h * sizeof(uint16_t);
+  lcd_blit_rect_async(pending->x, pending->y, pending->w, pending->h,
+                      pending->pixels, bytes, done_cb, user_data);
+  stats.windows++;
+  stats.bytes_sent += bytes;
+  pending->valid = false;
+}
+
+void lcd_shadow_blit_rect_async(uint8_t mask, size_t x, size_t y, size_t w,
+                                size_t h, uint16_t *pixels,
+                                lcd_blit_done_cb done_cb, void *user_data) {
+  assert(x + w <= LCD_WIDTH && y + h <= LCD_HEIGHT);
+
+  lcd_select_mask(mask);
+  if (!lcd_shadow_enabled()) {
+    lcd_blit_rect_async(x, y, w, h, pixels, w * h * sizeof(uint16_t), done_cb,
+                        user_data);
+    return;
+  }
+
+  stats.strips++;
+  stats.bytes_offered += w * h * sizeof(uint16_t);
+
+  uint16_t *out = pixels;
+  pending_send pending{};
+  dirty_window window{};
+  bool window_open = false;
+
+  auto close_window = [&]() {
+    if (!window_open) {
+      return;
+    }
+    send(&pending, nullptr, nullptr);
+    pending = {
+        .x = x + window.column_start,
+        .y = y + window.row_start,
+        .w = window.column_end - window.column_start,
+        .h = window.row_end - window.row_start,
+        .pixels = compact_window(pixels, w, window, &out),
+        .valid = true,
+    };
+    window_open = false;
+  };
+
+  for (size_t row = 0; row < h; row += LCD_SHADOW_TILE_HEIGHT) {
+    size_t tile_h = std::min(LCD_SHADOW_TILE_HEIGHT, h - row);
+
+    // every tile is visited so all the shadows stay current
+    size_t dirty_start = w;
+    size_t dirty_end = 0;
+    for (size_t column = 0; column < w; column += LCD_SHADOW_TILE_WIDTH) {
+      size_t tile_w = std::min(LCD_SHADOW_TILE_WIDTH, w - column);
+      if (update_tile(mask, x, y, w, pixels, column, row, tile_w, tile_h)) {
+        dirty_start = std::min(dirty_start, column);
+        dirty_end = column + tile_w;
+      }
+    }
+
+    if (dirty_start >= dirty_end) {
+      close_window();
+      continue;
+    }
+
+    if (window_open && window.column_start == dirty_start &&
+        window.column_end == dirty_end) {
+      window.row_end = row + tile_h;
+      continue;
+    }
+
+    close_window();
+    window = {.column_start = dirty_start,
+              .column_end = dirty_end,
+              .row_start = row,
+              .row_end = row + tile_h};
+    window_open = true;
+  }
+  close_window();
+  valid_mask |= mask;
+
+  if (pending.valid) {
+    send(&pending, done_cb, user_data);
+  } else if (done_cb != nullptr) {
+    done_cb(user_data); // nothing changed, the strip is already done with
+  }
+}
+
+lcd_shadow_stats lcd_shadow_get_stats() { return stats; }
+
+void lcd_shadow_reset_stats() { stats = {}; }
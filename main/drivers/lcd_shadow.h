@@ -0,0 +1,41 @@
+//  SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//  SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "lcds.h"
+
+// Optional copy in PSRAM of what each panel was last sent. Strips are
+// compared against it in tiles and only the windows that changed go out on
+// the bus, at the cost of reading and writing the shadow on every flush.
+
+constexpr size_t LCD_SHADOW_TILE_WIDTH = 16;
+constexpr size_t LCD_SHADOW_TILE_HEIGHT = 8;
+
+struct lcd_shadow_stats {
+  uint32_t strips;        // flushes that went through the shadow
+  uint32_t windows;       // windows left to send after diffing
+  uint32_t bytes_offered; // pixel bytes LVGL asked to send
+  uint32_t bytes_sent;    // pixel bytes that actually went out
+  uint32_t psram_bytes;   // shadow bytes read or written to decide that
+};
+
+// Allocates the shadows. Until this is called every flush is sent whole.
+void lcd_shadow_init();
+bool lcd_shadow_enabled();
+
+// Forgets what the panels in mask show, so their next flushes are sent whole
+void lcd_shadow_invalidate(uint8_t mask);
+
+// lcd_blit_rect_async() for the panels in mask, minus the tiles every one of
+// them already shows. The changed windows are compacted in place inside
+// pixels, which must stay valid until done_cb runs.
+void lcd_shadow_blit_rect_async(uint8_t mask, size_t x, size_t y, size_t w,
+                                size_t h, uint16_t *pixels,
+                                lcd_blit_done_cb done_cb, void *user_data);
+
+lcd_shadow_stats lcd_shadow_get_stats();
+void lcd_shadow_reset_stats();
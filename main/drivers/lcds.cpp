@@ -2,365 +2,303 @@
 //  SPDX-License-Identifier: MIT
 
 #include "lcds.h"
+#include "lcd_bus.h"
+#include "st7735.h"
 
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
-#include <driver/gpio.h>
-#include <driver/spi_master.h>
-#include <esp_heap_caps.h>
-#include <esp_log.h>
-#include <rom/ets_sys.h>
-
-// shared constants
-constexpr auto CONFIG_MOSI_GPIO = GPIO_NUM_13;
-constexpr auto CONFIG_SCLK_GPIO = GPIO_NUM_12;
-constexpr auto CONFIG_GPIO_DC = GPIO_NUM_14;
-constexpr auto CONFIG_GPIO_RESET = GPIO_NUM_27;
-constexpr auto CONFIG_GPIO_BL = GPIO_NUM_19;
+#include <cassert>
 
 constexpr auto CONFIG_WIDTH = 80;
 constexpr auto CONFIG_HEIGHT = 162;
 constexpr auto CONFIG_OFFSETX = 24;
 constexpr auto CONFIG_OFFSETY = 0;
 
-// unique constants per display
-/*
-  LCD1 CS pin     33
-  LCD2 CS pin     26
-  LCD3 CS pin     21
-  LCD4 CS pin     0
-  LCD5 CS pin     5
-  LCD6 CS pin     18
- */
-
-constexpr gpio_num_t GPIO_CS_PINS[NUM_LCDS] = {
-    GPIO_NUM_33, GPIO_NUM_26, GPIO_NUM_21, GPIO_NUM_0, GPIO_NUM_5, GPIO_NUM_18};
-constexpr auto TAG = "lcds";
-
-static spi_device_handle_t spi_device_handle = nullptr;
+static uint8_t selected_mask = 0; // panels new writes are sent to
 static bool initialized = false;
-static volatile bool async_tx_in_flight = false;
+static lcd_bus_stats bus_stats{};
+
+// Last CASET/RASET sent to each panel, packed as start << 16 | end. Zero
+// means unknown; a window that happens to pack to zero is just always resent.
+struct panel_window {
+  uint32_t columns;
+  uint32_t rows;
+};
+static panel_window panel_windows[NUM_LCDS];
+static lcd_color_mode panel_color_modes[NUM_LCDS];
+
+constexpr uint8_t COLMOD_12_BIT = 0x03;
+constexpr uint8_t COLMOD_16_BIT = 0x05;
 
 void init_red_tab();
-void deselect_all_displays();
 
 void lcds_init() {
-  assert(spi_device_handle == nullptr);
   assert(!initialized);
 
-  ESP_LOGI(TAG, "Configuring LCD SPI devices");
-
-  for (auto pin : GPIO_CS_PINS) {
-    gpio_reset_pin(pin);
-    gpio_set_direction(pin, GPIO_MODE_OUTPUT);
-  }
-  deselect_all_displays();
-
-  gpio_reset_pin(CONFIG_GPIO_RESET);
-  gpio_set_direction(CONFIG_GPIO_RESET, GPIO_MODE_OUTPUT);
-  gpio_set_level(CONFIG_GPIO_RESET, 1);
-
-  gpio_reset_pin(CONFIG_GPIO_DC);
-  gpio_set_direction(CONFIG_GPIO_DC, GPIO_MODE_OUTPUT);
-  gpio_set_level(CONFIG_GPIO_DC, 0);
-
-  gpio_reset_pin(CONFIG_GPIO_BL);
-  gpio_set_direction(CONFIG_GPIO_BL, GPIO_MODE_OUTPUT);
-  lcds_off();
-
-  spi_bus_config_t bus_config = {.mosi_io_num = CONFIG_MOSI_GPIO,
-                                 .miso_io_num = -1,
-                                 .sclk_io_num = CONFIG_SCLK_GPIO,
-                                 .quadwp_io_num = -1,
-                                 .quadhd_io_num = -1,
-                                 .max_transfer_sz = LCD_SPI_MAX_TRANSFER_SIZE};
-
-  ESP_ERROR_CHECK(spi_bus_initialize(SPI2_HOST, &bus_config, SPI_DMA_CH_AUTO));
-
+  lcd_bus_init();
   lcds_reset();
 
   lcds_on();
   initialized = true;
 
-  for (size_t i = 0; i < NUM_LCDS; i++) {
-    lcd_select(i);
-    init_red_tab();
-  }
-}
-
-void lcds_on() { gpio_set_level(CONFIG_GPIO_BL, 0); }
-void lcds_off() { gpio_set_level(CONFIG_GPIO_BL, 1); }
-
-void deselect_all_displays() {
-  for (auto i : GPIO_CS_PINS) {
-    gpio_set_level(i, 1);
-  }
+  // every panel gets the same init sequence, so send it once to all of them
+  lcd_select_mask(LCD_ALL_MASK);
+  init_red_tab();
 }
 
-void lcd_spi_pre_transfer_cb(spi_transaction_t *t) {
-  gpio_set_level(CONFIG_GPIO_DC, (int)t->user);
-}
+void lcds_on() { lcd_bus_set_backlight(true); }
+void lcds_off() { lcd_bus_set_backlight(false); }
 
 void lcd_select(size_t index) {
   assert(index < NUM_LCDS);
-  assert(initialized);
-  assert(!async_tx_in_flight);
-
-  deselect_all_displays();
-
-  spi_device_interface_config_t tft_devcfg = {
-      .clock_speed_hz = SPI_MASTER_FREQ_40M,
-      .spics_io_num = GPIO_CS_PINS[index],
-      .flags = SPI_DEVICE_NO_DUMMY,
-      .queue_size = 7,
-      .pre_cb = lcd_spi_pre_transfer_cb,
-  };
-
-  if (spi_device_handle) {
-    ESP_ERROR_CHECK(
-        spi_bus_remove_device(spi_device_handle)); // TODO cache up to three
-  }
-
-  ESP_ERROR_CHECK(
-      spi_bus_add_device(SPI2_HOST, &tft_devcfg, &spi_device_handle));
+  lcd_select_mask(1 << index);
 }
 
-void lcds_reset() {
-  gpio_set_level(CONFIG_GPIO_RESET, 0);
-  vTaskDelay(pdMS_TO_TICKS(100));
-  gpio_set_level(CONFIG_GPIO_RESET, 1);
-}
+void lcd_select_mask(uint8_t mask) {
+  assert(mask != 0 && (mask & ~LCD_ALL_MASK) == 0);
+  assert(initialized);
 
-#define CMD_NOP 0x0
-#define CMD_SWRESET 0x01
-#define CMD_RDDID 0x04
-#define CMD_RDDST 0x09
-
-#define CMD_SLPIN 0x10
-#define CMD_SLPOUT 0x11
-#define CMD_PTLON 0x12
-#define CMD_NORON 0x13
-
-#define CMD_INVOFF 0x20
-#define CMD_INVON 0x21
-#define CMD_DISPOFF 0x28
-#define CMD_DISPON 0x29
-#define CMD_CASET 0x2A
-#define CMD_RASET 0x2B
-#define CMD_RAMWR 0x2C
-#define CMD_RAMRD 0x2E
-
-#define CMD_COLMOD 0x3A
-#define CMD_MADCTL 0x36
-
-#define CMD_FRMCTR1 0xB1
-#define CMD_FRMCTR2 0xB2
-#define CMD_FRMCTR3 0xB3
-#define CMD_INVCTR 0xB4
-#define CMD_DISSET5 0xB6
-
-#define CMD_PWCTR1 0xC0
-#define CMD_PWCTR2 0xC1
-#define CMD_PWCTR3 0xC2
-#define CMD_PWCTR4 0xC3
-#define CMD_PWCTR5 0xC4
-#define CMD_VMCTR1 0xC5
-
-#define CMD_RDID1 0xDA
-#define CMD_RDID2 0xDB
-#define CMD_RDID3 0xDC
-#define CMD_RDID4 0xDD
-
-#define CMD_PWCTR6 0xFC
-
-#define CMD_GMCTRP1 0xE0
-#define CMD_GMCTRN1 0xE1
-
-void spi_write_bytes(const uint8_t *data, size_t length, uint8_t dc) {
-  if (length <= LCD_SPI_MAX_TRANSFER_SIZE) {
-    spi_transaction_t transaction = {
-        .length = length * 8,
-        .user = (void *)(uint32_t)dc,
-        .tx_buffer = data,
-    };
-
-    ESP_ERROR_CHECK(spi_device_polling_transmit(spi_device_handle, &transaction));
-  } else {
-    /* TODO all of these should probably be broken into smaller transactions
-     * that can fit (e.g. write fewer pixels at a time) */
-    const uint8_t *remaining_data = data;
-    size_t remaining_length = length;
-
-    while (remaining_length > 0) {
-      size_t this_send_length = remaining_length;
-      if (this_send_length > LCD_SPI_MAX_TRANSFER_SIZE) {
-        this_send_length = LCD_SPI_MAX_TRANSFER_SIZE;
-      }
-
-      spi_transaction_t transaction = {
-          .length = this_send_length * 8,
-          .tx_buffer = remaining_data,
-      };
-
-      ESP_ERROR_CHECK(spi_device_polling_transmit(spi_device_handle, &transaction));
-
-      remaining_length -= this_send_length;
-      remaining_data += this_send_length;
-    }
+  bus_stats.selects++;
+  if (mask == selected_mask) {
+    return;
   }
-}
 
-inline void write_command_byte(uint8_t command) {
-  spi_write_bytes(&command, 1, 0);
+  // chip select itself moves with the next transfer, in bus order
+  selected_mask = mask;
+  bus_stats.panel_switches++;
 }
 
-inline void write_data_byte(const uint8_t byte) {
-  spi_write_bytes(&byte, 1, 1);
+lcd_bus_stats lcds_get_bus_stats() {
+  lcd_bus_stats stats = bus_stats;
+  lcd_bus_collect_stats(&stats);
+  return stats;
 }
 
-inline void write_data_bytes(const uint8_t *data, size_t length) {
-  spi_write_bytes(data, length, 1);
+void lcds_reset_bus_stats() {
+  bus_stats = {};
+  lcd_bus_reset_stats();
 }
 
-void init_red_tab() {
-  // Init sequence adapted from
-  // https://github.com/boochow/MicroPython-ST7735/blob/master/ST7735.py
-
-  spi_device_acquire_bus(spi_device_handle, portMAX_DELAY);
+void lcds_reset() { lcd_bus_hardware_reset(); }
 
-  write_command_byte(CMD_SWRESET); // reset
-  ets_delay_us(150);
+void lcds_wait_idle() { lcd_bus_wait_idle(); }
 
-  write_command_byte(CMD_SLPOUT); // exit sleep
-  ets_delay_us(500);
+static void queue_bytes(const uint8_t *data, size_t length, uint8_t dc,
+                        lcd_blit_done_cb done_cb = nullptr,
+                        void *done_user_data = nullptr) {
+  lcd_bus_queue(selected_mask, dc, data, length, done_cb, done_user_data);
+}
 
-  {
-    uint8_t frtc3[] = {0x01, 0x2C, 0x2D};
-    uint8_t frtc6[] = {0x01, 0x2c, 0x2d, 0x01, 0x2c, 0x2d};
+// Init sequence adapted from
+// https://github.com/boochow/MicroPython-ST7735/blob/master/ST7735.py
+constexpr st7735_command INIT_RED_TAB_COMMANDS[] = {
+    st7735_cmd(CMD_SWRESET, {}, 150), // reset
+    st7735_cmd(CMD_SLPOUT, {}, 500),  // exit sleep
 
     // set frame rate
-    write_command_byte(CMD_FRMCTR1);
-    write_data_bytes(frtc3, sizeof(frtc3));
-
-    write_command_byte(CMD_FRMCTR2);
-    write_data_bytes(frtc3, sizeof(frtc3));
+    st7735_cmd(CMD_FRMCTR1, {0x01, 0x2C, 0x2D}),
+    st7735_cmd(CMD_FRMCTR2, {0x01, 0x2C, 0x2D}),
+    st7735_cmd(CMD_FRMCTR3, {0x01, 0x2c, 0x2d, 0x01, 0x2c, 0x2d}, 10),
+
+    st7735_cmd(CMD_INVCTR, {0x07}), // inversion control, TODO line inversion?
+
+    // TODO read datasheet, what is this power control stuff
+    st7735_cmd(CMD_PWCTR1, {0xA2, 0x02, 0x84}),
+    st7735_cmd(CMD_PWCTR2, {0xC5}), // VGH = 14.7V, VGL = -7.35V
+    st7735_cmd(CMD_PWCTR3,
+               {
+                   0x0A, // Opamp current small?,
+                   0x00  // Boost frequency
+               }),
+    st7735_cmd(CMD_PWCTR4,
+               {
+                   0x8A, // Opamp current small
+                   0x2A  // Boost frequency
+               }),
+    st7735_cmd(CMD_PWCTR5,
+               {
+                   0x8A, // Opamp current small
+                   0xEE  // Boost frequency
+               }),
+    st7735_cmd(CMD_VMCTR1, {0x0E}),
+
+    st7735_cmd(CMD_INVOFF),
+    st7735_cmd(CMD_MADCTL, {0xC8}), // 0xC0 is RGB, 0xC8 is BGR
+    st7735_cmd(CMD_COLMOD, {COLMOD_16_BIT}),
+
+    // TODO gamma curves?
+    st7735_cmd(CMD_GMCTRP1, {0x0f, 0x1a, 0x0f, 0x18, 0x2f, 0x28, 0x20, 0x22,
+                             0x1f, 0x1b, 0x23, 0x37, 0x00, 0x07, 0x02, 0x10}),
+    st7735_cmd(CMD_GMCTRN1,
+               {0x0f, 0x1b, 0x0f, 0x17, 0x33, 0x2c, 0x29, 0x2e, 0x30, 0x30,
+                0x39, 0x3f, 0x00, 0x07, 0x03, 0x10},
+               10),
+
+    st7735_cmd(CMD_DISPON, {}, 100),
+    st7735_cmd(CMD_NORON, {}, 10), // normal display on
+};
+
+constexpr auto INIT_RED_TAB = st7735_compile<INIT_RED_TAB_COMMANDS>();
+
+// Queues every command of a packed stream back to back, only waiting for the
+// bus to drain where the stream asks for a delay.
+static void run_command_stream(const uint8_t *stream, size_t length) {
+  const uint8_t *end = stream + length;
+
+  while (stream < end) {
+    uint8_t opcode = *stream++;
+    uint8_t flags = *stream++;
+    uint8_t argc = flags & ST7735_STREAM_ARGC_MASK;
+
+    queue_bytes(&opcode, 1, 0);
+    if (argc > 0) {
+      queue_bytes(stream, argc, 1); // the stream outlives the transfer
+      stream += argc;
+    }
 
-    write_command_byte(CMD_FRMCTR3);
-    write_data_bytes(frtc6, sizeof(frtc6));
+    if (flags & ST7735_STREAM_DELAY_FLAG) {
+      uint16_t delay_us = stream[0] | (stream[1] << 8);
+      stream += 2;
 
-    ets_delay_us(10);
+      lcd_bus_wait_idle();
+      lcd_bus_delay_us(delay_us);
+    }
   }
 
-  write_command_byte(CMD_INVCTR); // inversion control
-  write_data_byte(0x07);          // TODO line inversion?
+  lcd_bus_wait_idle();
+}
 
-  // TODO read datasheet, what is this power control stuff
-  {
-    uint8_t pwr3[] = {0xA2, 0x02, 0x84};
-    write_command_byte(CMD_PWCTR1);
-    write_data_bytes(pwr3, sizeof(pwr3));
+void init_red_tab() {
+  run_command_stream(INIT_RED_TAB.data(), INIT_RED_TAB.size());
+  for (size_t i = 0; i < NUM_LCDS; i++) {
+    if (selected_mask & (1 << i)) {
+      panel_windows[i] = {};
+      panel_color_modes[i] = LCD_COLOR_RGB565;
+    }
   }
+}
 
-  write_command_byte(CMD_PWCTR2);
-  write_data_byte(0xC5); // VGH = 14.7V, VGL = -7.35V
-
-  {
-    uint8_t pwr2[] = {
-        0x0A, // Opamp current small?,
-        0x00  // Boost frequency
-    };
-    write_command_byte(CMD_PWCTR3);
-    write_data_bytes(pwr2, sizeof(pwr2));
-  }
+// Sends a CASET or RASET unless every selected panel already has that range,
+// which is the common case for full-width LVGL strips. RAMWR always restarts
+// at the window origin, so skipping a repeated range is safe.
+static void set_window_range(uint8_t command, uint16_t start, uint16_t end,
+                             uint32_t panel_window::*cached) {
+  uint32_t range = (start << 16) | end;
 
-  {
-    uint8_t pwr2[] = {
-        0x8A, // Opamp current small
-        0x2A  // Boost frequency
-    };
-    write_command_byte(CMD_PWCTR4);
-    write_data_bytes(pwr2, sizeof(pwr2));
+  bool all_match = true;
+  for (size_t i = 0; i < NUM_LCDS; i++) {
+    if (selected_mask & (1 << i)) {
+      all_match = all_match && panel_windows[i].*cached == range;
+      panel_windows[i].*cached = range;
+    }
   }
-
-  {
-    uint8_t pwr2[] = {
-        0x8A, // Opamp current small
-        0xEE  // Boost frequency
-    };
-    write_command_byte(CMD_PWCTR5);
-    write_data_bytes(pwr2, sizeof(pwr2));
+  if (all_match) {
+    bus_stats.window_commands_skipped++;
+    return;
   }
 
-  write_command_byte(CMD_VMCTR1);
-  write_data_byte(0x0E);
+  uint8_t range_data[] = {static_cast<uint8_t>((start >> 8) & 0xFF),
+                          static_cast<uint8_t>(start & 0xFF),
+                          static_cast<uint8_t>((end >> 8) & 0xFF),
+                          static_cast<uint8_t>(end & 0xFF)};
+  queue_bytes(&command, 1, 0);
+  queue_bytes(range_data, sizeof(range_data), 1);
+}
 
-  write_command_byte(CMD_INVOFF);
+void lcd_set_color_mode(uint8_t mask, lcd_color_mode mode) {
+  lcd_select_mask(mask);
 
-  write_command_byte(CMD_MADCTL);
-  write_data_byte(0xC8); // 0xC0 is RGB, 0xC8 is BGR
+  const uint8_t colmod = CMD_COLMOD;
+  const uint8_t format = mode == LCD_COLOR_RGB444 ? COLMOD_12_BIT
+                                                  : COLMOD_16_BIT;
+  queue_bytes(&colmod, 1, 0);
+  queue_bytes(&format, 1, 1);
 
-  write_command_byte(CMD_COLMOD);
-  write_data_byte(0x05);
+  for (size_t i = 0; i < NUM_LCDS; i++) {
+    if (mask & (1 << i)) {
+      panel_color_modes[i] = mode;
+    }
+  }
+}
 
-  // TODO gamma curves?
-  {
-    uint8_t dataGMCTRP[] = {0x0f, 0x1a, 0x0f, 0x18, 0x2f, 0x28, 0x20, 0x22,
-                            0x1f, 0x1b, 0x23, 0x37, 0x00, 0x07, 0x02, 0x10};
-    write_command_byte(CMD_GMCTRP1);
-    write_data_bytes(dataGMCTRP, sizeof(dataGMCTRP));
+// Repacks big endian RGB565 into the panel's 12 bit format,
+//
+//   RRRRGGGG BBBBRRRR GGGGBBBB
+//
+// two pixels at a time. The output never catches up with the input, so it is
+// written over the strip. An odd last pixel goes out as two bytes; the panel
+// takes each pixel as soon as its twelve bits are in.
+static size_t pack_rgb444(uint8_t *pixels, size_t count) {
+  const uint8_t *in = pixels;
+  uint8_t *out = pixels;
+
+  auto to_rgb444 = [](const uint8_t *rgb565) {
+    // RRRRrGGG gggBbbbb -> RRRR GGGG BBBB
+    return static_cast<uint16_t>(((rgb565[0] & 0xF0) << 4) |
+                                 ((rgb565[0] & 0x07) << 5) |
+                                 ((rgb565[1] & 0x80) >> 3) |
+                                 ((rgb565[1] & 0x1E) >> 1));
+  };
 
-    uint8_t dataGMCTRN[] = {0x0f, 0x1b, 0x0f, 0x17, 0x33, 0x2c, 0x29, 0x2e,
-                            0x30, 0x30, 0x39, 0x3f, 0x00, 0x07, 0x03, 0x10};
-    write_command_byte(CMD_GMCTRN1);
-    write_data_bytes(dataGMCTRN, sizeof(dataGMCTRN));
-    ets_delay_us(10);
+  for (size_t i = 0; i + 1 < count; i += 2, in += 4) {
+    uint16_t first = to_rgb444(in);
+    uint16_t second = to_rgb444(in + 2);
+    *out++ = first >> 4;
+    *out++ = ((first & 0x0F) << 4) | (second >> 8);
+    *out++ = second & 0xFF;
   }
 
-  write_command_byte(CMD_DISPON);
-  ets_delay_us(100);
-
-  write_command_byte(CMD_NORON); // normal display on
-  ets_delay_us(10);
+  if (count % 2 != 0) {
+    uint16_t last = to_rgb444(in);
+    *out++ = last >> 4;
+    *out++ = (last & 0x0F) << 4;
+  }
 
-  spi_device_release_bus(spi_device_handle);
+  return out - pixels;
 }
 
-void lcd_blit_rect(int x, int y, int width, int height, const uint16_t *pixels,
-                   size_t pixels_size_bytes) {
+void lcd_blit_rect_async(int x, int y, int width, int height, uint16_t *pixels,
+                         size_t pixels_size_bytes, lcd_blit_done_cb done_cb,
+                         void *done_user_data) {
   if (width <= 0 || height <= 0) {
+    if (done_cb != nullptr) {
+      done_cb(done_user_data);
+    }
     return;
   }
 
   assert(pixels_size_bytes == width * height * sizeof(uint16_t));
 
-  spi_device_acquire_bus(spi_device_handle, portMAX_DELAY);
-
-  {
-    write_command_byte(CMD_CASET);
-    uint16_t xs = CONFIG_OFFSETX + x;
-    uint16_t xe = CONFIG_OFFSETX + x + width - 1;
-    uint8_t location_data[] = {static_cast<uint8_t>((xs >> 8) & 0xFF),
-                               static_cast<uint8_t>(xs & 0xFF),
-                               static_cast<uint8_t>((xe >> 8) & 0xFF),
-                               static_cast<uint8_t>(xe & 0xFF)};
-    write_data_bytes(location_data, sizeof(location_data));
+  // a broadcast has to agree on the format, it is only packed once
+  lcd_color_mode mode = LCD_COLOR_RGB565;
+  for (size_t i = 0; i < NUM_LCDS; i++) {
+    if (selected_mask & (1 << i)) {
+      mode = panel_color_modes[i];
+    }
+  }
+  for (size_t i = 0; i < NUM_LCDS; i++) {
+    assert((selected_mask & (1 << i)) == 0 || panel_color_modes[i] == mode);
   }
 
-  {
-    write_command_byte(CMD_RASET);
-    uint16_t ys = CONFIG_OFFSETY + y;
-    uint16_t ye = CONFIG_OFFSETY + y + height;
-    uint8_t location_data[] = {static_cast<uint8_t>((ys >> 8) & 0xFF),
-                               static_cast<uint8_t>(ys & 0xFF),
-                               static_cast<uint8_t>((ye >> 8) & 0xFF),
-                               static_cast<uint8_t>(ye & 0xFF)};
-    write_data_bytes(location_data, sizeof(location_data));
+  set_window_range(CMD_CASET, CONFIG_OFFSETX + x,
+                   CONFIG_OFFSETX + x + width - 1, &panel_window::columns);
+  set_window_range(CMD_RASET, CONFIG_OFFSETY + y,
+                   CONFIG_OFFSETY + y + height - 1, &panel_window::rows);
+
+  size_t send_size_bytes = pixels_size_bytes;
+  if (mode == LCD_COLOR_RGB444) {
+    send_size_bytes = pack_rgb444((uint8_t *)pixels, width * height);
   }
 
-  write_command_byte(CMD_RAMWR);
-  write_data_bytes((const uint8_t *)pixels, pixels_size_bytes);
+  const uint8_t ramwr = CMD_RAMWR;
+  queue_bytes(&ramwr, 1, 0);
+  queue_bytes((const uint8_t *)pixels, send_size_bytes, 1, done_cb,
+              done_user_data);
+}
 
-  spi_device_release_bus(spi_device_handle);
+void lcd_blit_rect(int x, int y, int width, int height, uint16_t *pixels,
+                   size_t pixels_size_bytes) {
+  lcd_blit_rect_async(x, y, width, height, pixels, pixels_size_bytes, nullptr,
+                      nullptr);
+  lcds_wait_idle();
 }
 
 uint16_t color_to_rgb565(uint8_t red, uint8_t green, uint8_t blue) {
@@ -9,14 +9,55 @@
 constexpr size_t NUM_LCDS = 6;
 constexpr uint8_t LCD_WIDTH = 80;
 constexpr uint8_t LCD_HEIGHT = 162;
-constexpr size_t LCD_SPI_MAX_TRANSFER_SIZE = 4092;
+// A third of a panel, so a full redraw takes three strips and transactions
+constexpr size_t LCD_SPI_MAX_TRANSFER_SIZE =
+    LCD_WIDTH * (LCD_HEIGHT / 3) * sizeof(uint16_t);
+constexpr uint8_t LCD_ALL_MASK = (1 << NUM_LCDS) - 1;
+
+// Counters for the shared LCD bus, used to measure the cost of panel switching
+struct lcd_bus_stats {
+  uint32_t selects;              // lcd_select() calls
+  uint32_t panel_switches;       // selects that actually moved chip select
+  uint32_t bus_reconfigurations; // SPI device add/remove operations
+  uint32_t transactions;         // SPI transactions queued
+  uint32_t broadcast_transactions; // transactions sent to several panels
+  uint32_t window_commands_skipped; // CASET/RASET already set on the panel
+  uint32_t bytes;                // bytes clocked out on MOSI
+  uint32_t bus_time_us; // modelled bus time, only filled in by the simulator
+};
+
+// What the panels are sent per pixel. LVGL always renders RGB565; RGB444
+// strips are repacked in place before they go out, at 3 bytes per 2 pixels.
+enum lcd_color_mode {
+  LCD_COLOR_RGB565,
+  LCD_COLOR_RGB444,
+};
+
+// Called from the SPI interrupt once a queued blit has left the bus
+using lcd_blit_done_cb = void (*)(void *user_data);
 
 void lcds_init();
 void lcd_select(size_t index);
-void lcd_blit_rect(int x, int y, int width, int height, const uint16_t *pixels,
+// Selects every panel whose bit is set; following writes reach all of them
+void lcd_select_mask(uint8_t mask);
+// Switches the panels in mask to another transfer format; takes effect for
+// the next blit
+void lcd_set_color_mode(uint8_t mask, lcd_color_mode mode);
+// pixels are big endian RGB565 and are overwritten if the selected panels
+// take RGB444
+void lcd_blit_rect(int x, int y, int width, int height, uint16_t *pixels,
                    size_t pixels_size_bytes);
+// Queues the blit and returns immediately; pixels must stay untouched until
+// done_cb runs
+void lcd_blit_rect_async(int x, int y, int width, int height, uint16_t *pixels,
+                         size_t pixels_size_bytes, lcd_blit_done_cb done_cb,
+                         void *done_user_data);
+void lcds_wait_idle();
 void lcds_reset();
 void lcds_on();
 void lcds_off();
 
+lcd_bus_stats lcds_get_bus_stats();
+void lcds_reset_bus_stats();
+
 uint16_t color_to_rgb565(uint8_t red, uint8_t green, uint8_t blue);
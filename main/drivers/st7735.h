@@ -0,0 +1,120 @@
+//  SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//  SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+
+#define CMD_NOP 0x0
+#define CMD_SWRESET 0x01
+#define CMD_RDDID 0x04
+#define CMD_RDDST 0x09
+
+#define CMD_SLPIN 0x10
+#define CMD_SLPOUT 0x11
+#define CMD_PTLON 0x12
+#define CMD_NORON 0x13
+
+#define CMD_INVOFF 0x20
+#define CMD_INVON 0x21
+#define CMD_DISPOFF 0x28
+#define CMD_DISPON 0x29
+#define CMD_CASET 0x2A
+#define CMD_RASET 0x2B
+#define CMD_RAMWR 0x2C
+#define CMD_RAMRD 0x2E
+
+#define CMD_COLMOD 0x3A
+#define CMD_MADCTL 0x36
+
+#define CMD_FRMCTR1 0xB1
+#define CMD_FRMCTR2 0xB2
+#define CMD_FRMCTR3 0xB3
+#define CMD_INVCTR 0xB4
+#define CMD_DISSET5 0xB6
+
+#define CMD_PWCTR1 0xC0
+#define CMD_PWCTR2 0xC1
+#define CMD_PWCTR3 0xC2
+#define CMD_PWCTR4 0xC3
+#define CMD_PWCTR5 0xC4
+#define CMD_VMCTR1 0xC5
+
+#define CMD_RDID1 0xDA
+#define CMD_RDID2 0xDB
+#define CMD_RDID3 0xDC
+#define CMD_RDID4 0xDD
+
+#define CMD_PWCTR6 0xFC
+
+#define CMD_GMCTRP1 0xE0
+#define CMD_GMCTRN1 0xE1
+
+// Command streams are packed at compile time into
+//
+//   opcode, flags | argc, args[argc], [delay_us low, delay_us high]
+//
+// repeated, so the executor can send each argument block as one transaction
+// straight out of flash without building anything at runtime.
+
+constexpr uint8_t ST7735_STREAM_DELAY_FLAG = 0x80;
+constexpr uint8_t ST7735_STREAM_ARGC_MASK = 0x7F;
+constexpr size_t ST7735_MAX_ARGS = 16;
+
+struct st7735_command {
+  uint8_t opcode;
+  uint8_t argc;
+  std::array<uint8_t, ST7735_MAX_ARGS> args;
+  uint16_t delay_us;
+};
+
+constexpr st7735_command st7735_cmd(uint8_t opcode,
+                                    std::initializer_list<uint8_t> args = {},
+                                    uint16_t delay_us = 0) {
+  st7735_command command{.opcode = opcode,
+                         .argc = static_cast<uint8_t>(args.size()),
+                         .args = {},
+                         .delay_us = delay_us};
+  size_t i = 0;
+  for (uint8_t arg : args) {
+    command.args[i++] = arg;
+  }
+  return command;
+}
+
+template <size_t N>
+constexpr size_t st7735_packed_size(const st7735_command (&commands)[N]) {
+  size_t size = 0;
+  for (const auto &command : commands) {
+    size += 2 + command.argc + (command.delay_us != 0 ? 2 : 0);
+  }
+  return size;
+}
+
+template <const auto &commands>
+constexpr auto st7735_compile() {
+  std::array<uint8_t, st7735_packed_size(commands)> packed{};
+
+  size_t i = 0;
+  for (const auto &command : commands) {
+    if (command.argc > ST7735_MAX_ARGS) {
+      throw "too many arguments for one command"; // fails the constant eval
+    }
+
+    packed[i++] = command.opcode;
+    packed[i++] = command.argc |
+                  (command.delay_us != 0 ? ST7735_STREAM_DELAY_FLAG : 0);
+    for (size_t arg = 0; arg < command.argc; arg++) {
+      packed[i++] = command.args[arg];
+    }
+    if (command.delay_us != 0) {
+      packed[i++] = command.delay_us & 0xFF;
+      packed[i++] = command.delay_us >> 8;
+    }
+  }
+
+  return packed;
+}
@@ -0,0 +1,79 @@
+//  SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//  SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "fpm/fixed.hpp"
+#include "fpm/math.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+// The flap's row mapping, kept free of LVGL so the host benchmarks can run
+// it as is.
+
+// The line the flap folds about, a little above the middle of the panel
+constexpr int flap_axis_y(int height) { return height / 2 - 4; }
+
+// Source row mapping of a flap `dest_height` rows tall showing source rows
+// src_y1..src_y2 in perspective. The key changes once per animation frame,
+// so the table can be shared by every strip drawn during that frame.
+struct flap_perspective_key {
+  int16_t src_y1;
+  int16_t src_y2;
+  int16_t dest_height;
+  bool invert;
+
+  bool operator==(const flap_perspective_key &other) const {
+    return src_y1 == other.src_y1 && src_y2 == other.src_y2 &&
+           dest_height == other.dest_height && invert == other.invert;
+  }
+};
+
+// Fills rows[0..count) with the source row for destination rows
+// first_row..first_row + count of the flap.
+//
+// Interpolating src_y is how we get the 3D effect. We can tell from the
+// height difference of the source area and the destination area where in
+// the animation we are, and solve for what the depth is at that point using
+// the equation of a circle, supplying Y and R and solving for X. That is the
+// maximum depth of the imaginary 3D rectangle we are drawing. Then we can use
+// the standard perspective-correct texture interpolation formula to figure
+// out which row of the source image to use for each row of the area being
+// drawn. Since we are always looking forward onto the screen surface, we only
+// have to do this once per row rather than for every pixel.
+inline void flap_perspective_rows(const flap_perspective_key &key,
+                                  int first_row, int count, int16_t *rows) {
+  using fpm::fixed_16_16;
+
+  int32_t radius = key.src_y2 - key.src_y1;
+  int32_t y_pos = (key.src_y2 - key.src_y1 + 1) - key.dest_height;
+
+  fixed_16_16 depth =
+      1 - (fpm::sqrt(fixed_16_16(radius * radius - y_pos * y_pos)) /
+           fixed_16_16(radius));
+
+  fixed_16_16 max_depth =
+      fixed_16_16(1) + (key.invert ? fixed_16_16(0) : depth);
+  fixed_16_16 min_depth =
+      fixed_16_16(1) + (key.invert ? depth : fixed_16_16(0));
+
+  for (int i = 0; i < count; i++) {
+    fixed_16_16 interpolation_alpha =
+        fixed_16_16(first_row + i) / fixed_16_16(key.dest_height);
+
+    // U_alpha = ((1 - alpha) * (U_0 / Z_0) + alpha * (U_1 / Z_1)) / ((1 -
+    // alpha) * (1 / Z_0) + alpha * (1 / Z_1))
+    fixed_16_16 src_yf =
+        (((fixed_16_16(1) - interpolation_alpha) * fixed_16_16(key.src_y1) /
+              min_depth +
+          interpolation_alpha * fixed_16_16(key.src_y2) / max_depth) /
+         ((fixed_16_16(1) - interpolation_alpha) / min_depth +
+          interpolation_alpha / max_depth));
+
+    // clamp for safety
+    rows[i] = static_cast<int16_t>(
+        std::clamp(static_cast<int>(src_yf), static_cast<int>(key.src_y1),
+                   static_cast<int>(key.src_y2)));
+  }
+}
@@ -5,64 +5,140 @@
 
 #pragma once
 
-#include <string>
-#include <utility>
-#include <vector>
+#include <algorithm>
+#include <array>
+#include <cstdint>
 
-#include <functional>
 #include <lvgl.h>
 
 #include "flapper.h"
+#include "flip_scheduler.h"
 
-using flap_sequence_update_callback =
-    std::function<void(const std::string &value)>;
+constexpr size_t FLAP_SEQUENCE_MAX_STEPS = 16;
 
+// Values are the caller's symbol indices
+using flap_sequence_update_callback = void (*)(uint8_t value, void *user_data);
+// Prerendered face showing value, which the flapper flips to and from
+using flap_sequence_sprite_callback =
+    const lv_img_dsc_t *(*)(uint8_t value, void *user_data);
+// How to get from one value to the next, for each step
+using flap_sequence_transition_callback =
+    transition_kernel (*)(uint8_t from_value, uint8_t to_value,
+                          void *user_data);
+
+// Flips a panel through a run of values one after another. Lives as long as
+// the panel does and is refilled for each run, so nothing is allocated.
 class flap_sequence {
 public:
-  explicit flap_sequence(flapper *flapper_,
-                         flap_sequence_update_callback update_cb,
-                         std::vector<std::string> &values)
-      : values(values) {
+  // Steps are started by scheduler, as the flips of panel
+  void bind(flapper *flapper_, flip_scheduler *scheduler, size_t panel,
+            flap_sequence_update_callback update_cb,
+            flap_sequence_sprite_callback sprite_cb,
+            flap_sequence_transition_callback transition_cb,
+            void *user_data) {
     this->flapper_ = flapper_;
-    this->update_cb = std::move(update_cb);
+    this->scheduler = scheduler;
+    this->panel = panel;
+    this->update_cb = update_cb;
+    this->sprite_cb = sprite_cb;
+    this->transition_cb = transition_cb;
+    this->user_data = user_data;
+  }
+
+  // Replaces whatever run was set, started or not. A flip of the old run
+  // that is still going is cut short when the new run's first step starts,
+  // and if it ends before then, ending it doesn't step the new run twice.
+  void set(uint8_t initial_value, const uint8_t *values, size_t count) {
+    LV_ASSERT(count <= this->values.size());
+    scheduler->cancel(panel);
+    requested = false;
+    std::copy_n(values, count, this->values.begin());
+    value_count = count;
+    next_value_index = 0;
+    current_value = initial_value;
+    started = false;
   }
 
-  ~flap_sequence() = default;
+  // Heads for a new run from wherever the panel is going now, instead of
+  // starting over: a flip that is still going finishes and the run carries
+  // on from it, and a step already waiting for the bus takes the run's first
+  // value. Starts the run, and with no values just stops where it is going.
+  void retarget(const uint8_t *values, size_t count) {
+    LV_ASSERT(count <= this->values.size());
+    std::copy_n(values, count, this->values.begin());
+    value_count = count;
+    next_value_index = 0;
+    started = true;
+
+    if (count == 0 && requested) {
+      scheduler->cancel(panel);
+      requested = false;
+    } else if (!requested && !flipping) {
+      next_step();
+    }
+  }
 
   void start() {
-    lv_async_call(
-        [](void *user_data) {
-          auto *this_ = static_cast<flap_sequence *>(user_data);
-          this_->next_step();
-        },
-        this);
+    started = true;
+    next_step();
   }
 
+  bool finished() const { return next_value_index >= value_count; }
+  // What the panel shows, or is flipping to
+  uint8_t value() const { return current_value; }
+
 private:
+  // Waits for the scheduler to let the next step onto the bus
   void next_step() {
-    if (next_value_index >= values.size()) {
+    if (!started || finished() || requested) {
       return;
     }
 
-    auto &value = values[next_value_index++];
+    kernel = transition_cb(current_value, values[next_value_index], user_data);
+    requested = true;
+    scheduler->request(
+        panel, flapper_->estimated_bus_bytes(kernel),
+        [](void *user_data) {
+          static_cast<flap_sequence *>(user_data)->flip_next();
+        },
+        this);
+  }
+
+  void flip_next() {
+    requested = false;
+    flipping = true;
+    uint8_t value = values[next_value_index++];
 
-    flapper_->before();
-    update_cb(value);
-    flapper_->after();
+    flapper_->before(sprite_cb(current_value, user_data));
+    current_value = value;
+    update_cb(value, user_data);
+    flapper_->after(sprite_cb(value, user_data));
 
     flapper_->set_finished_callback(
         [](void *user_data) {
           auto *this_ = static_cast<flap_sequence *>(user_data);
+          this_->flipping = false;
           this_->next_step();
         },
         this);
 
-    bool last = next_value_index == values.size();
-    flapper_->start(last);
+    bool last = next_value_index == value_count;
+    flapper_->start(last, kernel);
   }
 
-  flapper *flapper_;
-  flap_sequence_update_callback update_cb;
-  std::vector<std::string> values;
+  flapper *flapper_{};
+  flip_scheduler *scheduler{};
+  size_t panel{};
+  transition_kernel kernel{transition_flip};
+  flap_sequence_update_callback update_cb{};
+  flap_sequence_sprite_callback sprite_cb{};
+  flap_sequence_transition_callback transition_cb{};
+  void *user_data{};
+  std::array<uint8_t, FLAP_SEQUENCE_MAX_STEPS> values{};
+  size_t value_count{0};
   size_t next_value_index{0};
+  uint8_t current_value{};
+  bool started{false};
+  bool requested{false}; // a step is waiting for the scheduler
+  bool flipping{false};  // the flapper is on one of this run's steps
 };
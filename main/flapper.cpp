@@ -4,11 +4,10 @@
 //
 
 #include "flapper.h"
-#include "fpm/fixed.hpp"
-#include "fpm/math.hpp"
-#include "spiram_allocate.h"
+#include "flip_cache.h"
 #include <algorithm>
 #include <cassert>
+#include <cstring>
 
 // TODO remove
 #include "gui.h"
@@ -16,6 +15,46 @@
 
 // constexpr auto FLIP_DURATION_MS = 5000;
 constexpr auto FLIP_DURATION_MS = 1000;
+// LCD_COLOR_RGB444 sends a quarter fewer bytes per flip frame, at the cost of
+// banding until the flip lands and the panel is repainted at full depth
+constexpr auto FLIP_COLOR_MODE = LCD_COLOR_RGB565;
+// Skip animation steps while the panel is still receiving the previous frame,
+// rather than queueing every one of them behind it on a busy bus. The next
+// frame drawn lands wherever the animation has got to by then.
+constexpr bool FLIP_FRAME_PACING = true;
+// The deadline for each frame: a frame still in flight this long after the
+// one before it was drawn no longer holds the flap up
+constexpr uint32_t FLIP_FRAME_DEADLINE_MS = 100;
+// Only the GUI task renders faces, one at a time, so every flapper shares
+// the one draw context
+static lv_draw_sw_ctx_t render_draw_ctx;
+
+flapper::flapper(lv_obj_t *screen, snapshot_pool *snapshots,
+                 snapshot_pool *hot_rows) {
+  this->screen = screen;
+  this->snapshots = snapshots;
+  this->hot_rows = hot_rows;
+
+  // Both timers are made once and paused between flips, where lv_anim and
+  // lv_async_call would allocate for every flip
+  animation_timer = lv_timer_create(
+      [](lv_timer_t *timer) {
+        static_cast<flapper *>(timer->user_data)->step();
+      },
+      LV_DISP_DEF_REFR_PERIOD, this);
+  lv_timer_pause(animation_timer);
+  finished_timer = lv_timer_create(
+      [](lv_timer_t *timer) {
+        lv_timer_pause(timer);
+        auto *instance = static_cast<flapper *>(timer->user_data);
+        instance->finished_callback(instance->finished_callback_user_data);
+      },
+      0, this);
+  lv_timer_pause(finished_timer);
+  lv_anim_init(&path);
+  lv_anim_set_time(&path, FLIP_DURATION_MS);
+  lv_anim_set_values(&path, 0, TRANSITION_PROGRESS_MAX);
+}
 
 void flapper::before() {
   cancel_existing_animation();
@@ -23,12 +62,19 @@ void flapper::before() {
   size_t buffer_size =
       lv_snapshot_buf_size_needed(screen, LV_IMG_CF_TRUE_COLOR);
 
-  spiram_free(snapshot1_buffer);
-  snapshot1 = {};
-  snapshot1_buffer = spiram_allocate(buffer_size);
-  lv_res_t result = lv_snapshot_take_to_buf(
-      screen, LV_IMG_CF_TRUE_COLOR, &snapshot1, snapshot1_buffer, buffer_size);
-  assert(result == LV_RES_OK);
+  if (snapshot1_buffer == nullptr) {
+    snapshot1_buffer = snapshots->acquire(buffer_size);
+  }
+  flapper_snapshot(screen, &snapshot1, snapshot1_buffer);
+  from_image = &snapshot1;
+}
+
+void flapper::before(const lv_img_dsc_t *image) {
+  stop_animation(); // an atlas flip can start from a resting one
+  if (overlay_shown() && image != from_image) {
+    lv_obj_invalidate(overlay); // resting on something else, redraw it all
+  }
+  from_image = image;
 }
 
 void flapper::after() {
@@ -37,401 +83,406 @@ void flapper::after() {
   size_t buffer_size =
       lv_snapshot_buf_size_needed(screen, LV_IMG_CF_TRUE_COLOR);
 
-  spiram_free(snapshot2_buffer);
-  snapshot2 = {};
-  snapshot2_buffer = spiram_allocate(buffer_size);
-  lv_res_t result = lv_snapshot_take_to_buf(
-      screen, LV_IMG_CF_TRUE_COLOR, &snapshot2, snapshot2_buffer, buffer_size);
-  assert(result == LV_RES_OK);
+  if (snapshot2_buffer == nullptr) {
+    snapshot2_buffer = snapshots->acquire(buffer_size);
+  }
+  flapper_snapshot(screen, &snapshot2, snapshot2_buffer);
+  to_image = &snapshot2;
+}
+
+void flapper::after(const lv_img_dsc_t *image) {
+  stop_animation();
+  to_image = image;
 }
 
 void flapper::cancel_existing_animation() {
-  if (overlay != nullptr) {
-    lv_obj_del(overlay);
-    overlay = nullptr;
+  hide_overlay();
+  stop_animation();
+}
+
+void flapper::stop_animation() {
+  if (!animating) {
+    return;
+  }
+  animating = false;
+  lv_timer_pause(animation_timer);
+  animation_deleted();
+}
+
+// Made on the first flip and hidden rather than deleted after, so the flips
+// after that don't allocate it again
+bool flapper::overlay_shown() const {
+  return overlay != nullptr && !lv_obj_has_flag(overlay, LV_OBJ_FLAG_HIDDEN);
+}
+
+void flapper::hide_overlay() {
+  if (overlay_shown()) {
+    lv_obj_add_flag(overlay, LV_OBJ_FLAG_HIDDEN);
   }
-  lv_anim_del(screen, nullptr);
 }
 
-void flapper::start(bool last) {
-  assert(snapshot1_buffer != nullptr);
-  assert(snapshot2_buffer != nullptr);
-  lv_anim_del(screen, nullptr);
-
-  lv_anim_t animation;
-  lv_anim_init(&animation);
-
-  lv_anim_set_user_data(&animation, this);
-  lv_anim_set_var(&animation, screen); // only really used for deduplication
-  lv_anim_set_custom_exec_cb(&animation, [](lv_anim_t *anim, int32_t value) {
-    auto *instance = static_cast<flapper *>(anim->user_data);
-    instance->animate(value);
-  });
-  lv_anim_set_deleted_cb(&animation, [](lv_anim_t *anim) {
-    auto *instance = static_cast<flapper *>(anim->user_data);
-    instance->animation_deleted();
-  });
-
-  lv_anim_set_time(&animation, FLIP_DURATION_MS);
-  lv_anim_set_path_cb(&animation,
-                      last ? lv_anim_path_bounce : lv_anim_path_ease_in_out);
-  lv_anim_set_values(&animation, 0, lv_obj_get_height(screen));
+void flapper::start(bool last, transition_kernel kernel) {
+  assert(from_image != nullptr && to_image != nullptr);
+  stop_animation();
+  // a flip this one cuts short was superseded, not finished, so whoever
+  // started this one isn't told it has ended
+  lv_timer_pause(finished_timer);
+
+  // only a flap has anything to bounce off
+  lv_anim_set_path_cb(&path, last && kernel == transition_flip
+                                 ? lv_anim_path_bounce
+                                 : lv_anim_path_ease_in_out);
 
   lv_coord_t width = lv_obj_get_width(screen);
   lv_coord_t height = lv_obj_get_height(screen);
 
-  if (overlay != nullptr) {
-    lv_obj_del(overlay);
+  // an overlay resting on an atlas image is reused as is, and a hidden one
+  // shown again
+  if (overlay == nullptr) {
+    overlay = lv_obj_create(screen);
+    lv_obj_remove_style_all(overlay);
+    // Opaque, so LVGL takes the overlay as the top object and stops drawing
+    // the background and labels underneath every frame. The black shows
+    // through as the gap at the hinge.
+    lv_obj_set_style_bg_color(overlay, lv_color_black(), LV_PART_MAIN);
+    lv_obj_set_style_bg_opa(overlay, LV_OPA_COVER, LV_PART_MAIN);
+    lv_obj_add_event_cb(
+        overlay,
+        [](lv_event_t *event) {
+          auto *instance =
+              static_cast<flapper *>(lv_event_get_user_data(event));
+          instance->draw_overlay(event);
+        },
+        LV_EVENT_DRAW_MAIN, this);
+    lv_obj_set_size(overlay, width, height);
+  } else if (!overlay_shown()) {
+    // on top of anything made on the screen since it was last up
+    lv_obj_clear_flag(overlay, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_move_foreground(overlay);
   }
-  overlay = lv_obj_create(screen);
-  lv_obj_remove_style_all(overlay);
-  //  lv_obj_set_style_opa(overlay, LV_OPA_COVER, LV_PART_ANY);
-  lv_obj_add_event_cb(
-      overlay,
-      [](lv_event_t *event) {
-        auto *instance = static_cast<flapper *>(lv_event_get_user_data(event));
-        instance->draw_overlay(event);
-      },
-      LV_EVENT_DRAW_MAIN, this);
-  lv_obj_set_size(overlay, width, height);
-
-  lv_anim_start(&animation);
+  // the first frame then redraws everything above the flap
+  this->kernel = kernel;
+  progress = 0;
+  last_progress = 0;
+  flip_start_ms = lv_tick_get();
+  flip_frames = 0;
+  motion_watched = motion_armed;
+  motion_armed = false;
+  flip_external_bytes = 0;
+  stage_hot_rows();
+
+  gui_set_color_mode(lv_obj_get_disp(screen), FLIP_COLOR_MODE);
+  // the first frame goes out now, the rest once a display refresh
+  animating = true;
+  animate(0);
+  lv_timer_reset(animation_timer);
+  lv_timer_resume(animation_timer);
 }
 
 flapper::~flapper() {
-  lv_anim_del(screen, nullptr);
+  stop_animation();
+  lv_timer_del(animation_timer);
+  lv_timer_del(finished_timer);
+  release_hot_rows();
 
-  if (snapshot1_buffer != nullptr) {
-    spiram_free(snapshot1_buffer);
-    snapshot1_buffer = nullptr;
-  }
-  if (snapshot2_buffer != nullptr) {
-    spiram_free(snapshot2_buffer);
-    snapshot2_buffer = nullptr;
-  }
+  snapshots->release(snapshot1_buffer);
+  snapshot1_buffer = nullptr;
+  snapshots->release(snapshot2_buffer);
+  snapshot2_buffer = nullptr;
 
   if (overlay != nullptr) {
     lv_obj_del(overlay);
   }
 }
 
+void flapper::step() {
+  path.act_time = static_cast<int32_t>(
+      std::min<uint32_t>(lv_tick_elaps(flip_start_ms), FLIP_DURATION_MS));
+  animate(path.path_cb(&path));
+  if (path.act_time == FLIP_DURATION_MS) {
+    stop_animation();
+  }
+}
+
 void flapper::animate(int32_t value) {
-  if (overlay == nullptr) {
+  if (!overlay_shown()) {
     return;
   }
 
-  lv_coord_t axis = compute_center_axis_y();
-  lv_area_t dirty_area = {.x1 = 0,
-                          .y1 = std::min(last_divider_y, axis),
-                          .x2 = lv_obj_get_width(overlay),
-                          .y2 = std::max(axis, (lv_coord_t)(value + 3))};
-  lv_obj_invalidate_area(overlay, &dirty_area);
+  // invalidating from the last divider actually drawn covers every step
+  // skipped in between
+  if (FLIP_FRAME_PACING && flip_frames > 0 &&
+      lv_tick_elaps(last_frame_ms) < FLIP_FRAME_DEADLINE_MS &&
+      gui_frame_in_flight(lv_obj_get_disp(screen))) {
+    stats.dropped_frames++;
+    return;
+  }
+  last_frame_ms = lv_tick_get();
+  flip_frames++;
+  stats.frames++;
+
+  if (kernel == transition_flip) {
+    // only the rows the flap and the divider have passed over change
+    lv_coord_t height = lv_obj_get_height(overlay);
+    lv_coord_t axis = compute_center_axis_y();
+    lv_coord_t last_divider_y =
+        (lv_coord_t)transition_flip_divider_y(last_progress, height);
+    lv_coord_t divider_y =
+        (lv_coord_t)transition_flip_divider_y(value, height);
+    lv_area_t dirty_area = {
+        .x1 = 0,
+        .y1 = std::min(last_divider_y, axis),
+        .x2 = lv_obj_get_width(overlay),
+        .y2 = std::max(axis, (lv_coord_t)(divider_y + 3))};
+    lv_obj_invalidate_area(overlay, &dirty_area);
+  } else {
+    lv_obj_invalidate(overlay);
+  }
 
-  last_divider_y = divider_y;
-  divider_y = static_cast<lv_coord_t>(value);
+  last_progress = progress;
+  progress = value;
+  if (kernel == transition_flip &&
+      transition_flip_divider_y(value, lv_obj_get_height(overlay)) >
+          compute_center_axis_y()) {
+    stage_hot_bottom();
+  }
 }
 
 void flapper::animation_deleted() {
+  uint32_t elapsed_ms = lv_tick_elaps(flip_start_ms);
+  if (elapsed_ms > 0) {
+    stats.fps = flip_frames * 1000.0f / elapsed_ms;
+  }
+  if (flip_frames > 0) {
+    stats.external_bytes_per_frame = flip_external_bytes / flip_frames;
+  }
+  stats.hot_rows_internal = hot_buffer != nullptr;
+  release_hot_rows();
+
   if (finished_callback) {
-    lv_async_call(
-        [](void *user_data) {
-          auto *instance = static_cast<flapper *>(user_data);
-          instance->finished_callback(instance->finished_callback_user_data);
-        },
-        this);
+    lv_timer_resume(finished_timer); // called back on the next timer pass
   }
 
-  if (snapshot1_buffer != nullptr) {
-    spiram_free(snapshot1_buffer);
-    snapshot1_buffer = nullptr;
+  if (to_image != nullptr && to_image != &snapshot2 && overlay_shown()) {
+    // Atlas images outlive the flip, so the overlay stays up showing the new
+    // face and the objects underneath never have to be drawn again
+    if (progress != TRANSITION_PROGRESS_MAX) { // cut short, jump to the end
+      progress = last_progress = TRANSITION_PROGRESS_MAX;
+      lv_obj_invalidate(overlay);
+    }
+    from_image = to_image;
+  } else {
+    hide_overlay();
+    from_image = nullptr;
+    to_image = nullptr;
   }
+
+  snapshots->release(snapshot1_buffer);
+  snapshot1_buffer = nullptr;
   snapshot1 = {};
 
-  if (snapshot2_buffer != nullptr) {
-    spiram_free(snapshot2_buffer);
-    snapshot2_buffer = nullptr;
-  }
+  snapshots->release(snapshot2_buffer);
+  snapshot2_buffer = nullptr;
   snapshot2 = {};
 
-  if (overlay != nullptr) {
-    lv_obj_del(overlay);
-    overlay = nullptr;
-  }
+  gui_set_color_mode(lv_obj_get_disp(screen), LCD_COLOR_RGB565);
 }
 
-void copy_partial_image_flat(uint8_t *destination_buffer, lv_coord_t buf_width,
-                             lv_coord_t buf_height, const lv_area_t &dest_area,
-                             const lv_img_dsc_t &source_image,
-                             const lv_area_t &source_area) {
-  LV_ASSERT(lv_area_get_width(&source_area) == lv_area_get_width(&dest_area));
-  LV_ASSERT(lv_area_get_height(&source_area) == lv_area_get_height(&dest_area));
-
-  const size_t bytes_per_buf_row = buf_width * sizeof(lv_color_t);
-  const uint32_t source_image_width = source_image.header.w;
-  const uint32_t source_image_height = source_image.header.h;
-  const size_t bytes_per_src_row = source_image_width * sizeof(lv_color_t);
-  const size_t width_pixels = source_area.x2 - source_area.x1 + 1;
-
-  for (lv_coord_t dst_y = dest_area.y1, src_y = source_area.y1;
-       dst_y <= dest_area.y2 && src_y <= source_area.y2; dst_y++, src_y++) {
-
-    const size_t dst_offset =
-        bytes_per_buf_row * dst_y + dest_area.x1 * sizeof(lv_color_t);
-    uint8_t *dst_ptr = destination_buffer + dst_offset;
-
-    const size_t src_offset =
-        bytes_per_src_row * src_y + source_area.x1 * sizeof(lv_color_t);
-    const uint8_t *src_ptr = source_image.data + src_offset;
-
-    size_t copy_size = width_pixels * sizeof(lv_color_t);
-
-    LV_ASSERT(src_offset + copy_size <=
-              source_image_width * source_image_height * sizeof(lv_color_t));
-    LV_ASSERT(dst_offset + copy_size <=
-              buf_width * buf_height * sizeof(lv_color_t));
-    lv_memcpy(dst_ptr, src_ptr, copy_size);
+const int16_t *flapper::perspective_rows(const flap_perspective_key &key) {
+  LV_ASSERT(key.dest_height > 0 && key.dest_height <= LCD_HEIGHT);
+
+  if (const int16_t *cached = flip_cache_rows(key)) {
+    return cached;
   }
-}
 
-void flapper::copy_partial_image_perspective(
-    uint8_t *destination_buffer, lv_coord_t buf_width, lv_coord_t buf_height,
-    const lv_area_t &dest_area, const lv_area_t &unclipped_dest_area,
-    const lv_img_dsc_t &source_image, const lv_area_t &source_area,
-    bool invert) {
-  LV_ASSERT(lv_area_get_width(&source_area) == lv_area_get_width(&dest_area));
-
-  const size_t bytes_per_buf_row = buf_width * sizeof(lv_color_t);
-  const uint32_t source_image_width = source_image.header.w;
-  const uint32_t source_image_height = source_image.header.h;
-  const size_t bytes_per_src_row = source_image_width * sizeof(lv_color_t);
-
-  const size_t width_pixels = source_area.x2 - source_area.x1 + 1;
-
-  // Interpolating src_y is how we get the 3D effect. We can tell from the
-  // height difference of the source area and the destination area where
-  // in the animation we are, and solve for what the depth is at that point
-  // using the equation of a circle, supplying Y and R and solving for X. That
-  // is the maximum depth of the imaginary 3D rectangle we are drawing. Then
-  // we can use the standard perspective-correct texture interpolation formula
-  // to figure out which row of the source image to use for each row of the
-  // area being drawn. Since we are always looking forward onto the screen
-  // surface, we only have to do this once per row rather than for every
-  // pixel, keeping the calculation (relatively) cheap CPU-wise
-
-  int32_t radius = source_area.y2 - source_area.y1;
-
-  lv_coord_t unclipped_dest_height = lv_area_get_height(&unclipped_dest_area);
-  int32_t y_pos = lv_area_get_height(&source_area) - unclipped_dest_height;
-
-  fpm::fixed_16_16 depth =
-      1 - (fpm::sqrt(fpm::fixed_16_16(radius * radius - y_pos * y_pos)) / fpm::fixed_16_16(radius));
-  //  lv_sqrt_res_t depth_fp;
-  //  lv_sqrt(radius * radius - y_pos * y_pos, &depth_fp, 0x800);
-
-  fpm::fixed_16_16 max_depth =
-      fpm::fixed_16_16(1) + (invert ? fpm::fixed_16_16(0) : depth);
-  fpm::fixed_16_16 min_depth =
-      fpm::fixed_16_16(1) + (invert ? depth : fpm::fixed_16_16(0));
-
-  for (lv_coord_t dst_y = dest_area.y1; dst_y <= dest_area.y2; dst_y++) {
-    fpm::fixed_16_16 interpolation_alpha =
-        fpm::fixed_16_16(dst_y - unclipped_dest_area.y1) /
-        fpm::fixed_16_16(unclipped_dest_height);
-
-    // U_alpha = ((1 - alpha) * (U_0 / Z_0) + alpha * (U_1 / Z_1)) / ((1 -
-    // alpha) * (1 / Z_0) + alpha * (1 / Z_1))
-    fpm::fixed_16_16 src_yf =
-        (((fpm::fixed_16_16(1) - interpolation_alpha) *
-              fpm::fixed_16_16(source_area.y1) / min_depth +
-          interpolation_alpha * fpm::fixed_16_16(source_area.y2) / max_depth) /
-         ((fpm::fixed_16_16(1) - interpolation_alpha) / min_depth +
-          interpolation_alpha / max_depth));
-
-    //    auto linear_src_yf = (1.0f - interpolation_alpha) *
-    //    (float)source_area.y1 +
-    //                         interpolation_alpha * (float)source_area.y2;
-
-    //    if(lv_obj_get_screen(overlay) ==
-    //    lv_disp_get_scr_act(gui_get_display(0))) {
-    //      printf("y_pos: %d, depth: %f, linear: %f, persp: %f\n", y_pos,
-    //      depth, linear_src_yf, src_yf);
-    //    }
-
-    // clamp for safety
-    lv_coord_t src_y =
-        std::max(std::min((lv_coord_t)src_yf, (lv_coord_t)source_area.y2),
-                 (lv_coord_t)source_area.y1);
-
-    const size_t dst_offset =
-        bytes_per_buf_row * dst_y + dest_area.x1 * sizeof(lv_color_t);
-    uint8_t *dst_ptr = destination_buffer + dst_offset;
-
-    const size_t src_offset =
-        bytes_per_src_row * src_y + source_area.x1 * sizeof(lv_color_t);
-    const uint8_t *src_ptr = source_image.data + src_offset;
-
-    size_t copy_size = width_pixels * sizeof(lv_color_t);
-
-    LV_ASSERT(src_offset + copy_size <=
-              source_image_width * source_image_height * sizeof(lv_color_t));
-    LV_ASSERT(dst_offset + copy_size <=
-              buf_width * buf_height * sizeof(lv_color_t));
-    lv_memcpy(dst_ptr, src_ptr, copy_size);
+  // dest_height is never zero for a drawn half, so the zeroed key only
+  // matches before the first frame has been worked out
+  if (!(key == perspective_key)) {
+    flap_perspective_rows(key, 0, key.dest_height, perspective_lut.data());
+    perspective_key = key;
   }
+  return perspective_lut.data();
 }
 
 void flapper::draw_overlay(lv_event_t *event) {
   auto *draw_ctx = lv_event_get_draw_ctx(event);
-  auto *destination_buffer = static_cast<uint8_t *>(draw_ctx->buf);
+  if (motion_watched && progress > 0) {
+    motion_watched = false;
+    motion_callback(lv_tick_get(), motion_callback_user_data);
+  }
+
+  lv_area_t overlay_area, clip_area;
+  lv_obj_get_coords(overlay, &overlay_area);
+  if (!_lv_area_intersect(&clip_area, draw_ctx->clip_area, &overlay_area)) {
+    return;
+  }
+
+  // the kernels work in panel coordinates, which is to say the overlay's
+  lv_area_t buf_area = *draw_ctx->buf_area;
+  lv_area_move(&clip_area, (lv_coord_t)(-overlay_area.x1),
+               (lv_coord_t)(-overlay_area.y1));
+  lv_area_move(&buf_area, (lv_coord_t)(-overlay_area.x1),
+               (lv_coord_t)(-overlay_area.y1));
+
+  transition_frame frame{
+      .before = {},
+      .after = {},
+      .width = lv_area_get_width(&overlay_area),
+      .height = lv_area_get_height(&overlay_area),
+      .progress = progress,
+      .clip = {clip_area.x1, clip_area.y1, clip_area.x2, clip_area.y2},
+      .dest = static_cast<uint16_t *>(draw_ctx->buf),
+      .dest_area = {buf_area.x1, buf_area.y1, buf_area.x2, buf_area.y2},
+      .byte_swapped = LV_COLOR_16_SWAP != 0,
+      .perspective_rows =
+          [](const flap_perspective_key &key, void *user_data) {
+            return static_cast<flapper *>(user_data)->perspective_rows(key);
+          },
+      .user_data = this};
 
   // preconditions
-  LV_ASSERT((lv_img_cf_get_px_size(snapshot1.header.cf) >> 3) ==
+  const lv_img_dsc_t &from = *from_image;
+  const lv_img_dsc_t &to = *to_image;
+  LV_ASSERT((lv_img_cf_get_px_size(from.header.cf) >> 3) ==
                 sizeof(lv_color_t) &&
-            snapshot1.header.cf == LV_IMG_CF_TRUE_COLOR);
-  LV_ASSERT((lv_img_cf_get_px_size(snapshot2.header.cf) >> 3) ==
-            sizeof(lv_color_t));
-  lv_coord_t buf_width = lv_area_get_width(draw_ctx->buf_area);
-  lv_coord_t buf_height = lv_area_get_height(draw_ctx->buf_area);
-
-  lv_coord_t axis = compute_center_axis_y();
-
-  // top part
-  {
-    lv_area_t obj_area, source_area, dest_area;
-    lv_obj_get_coords(overlay, &obj_area);
-    lv_coord_t left = obj_area.x1;
-    lv_coord_t top = obj_area.y1;
-    obj_area.y2 =
-        (lv_coord_t)(obj_area.y1 +
-                     std::min((lv_coord_t)(divider_y - 1),
-                              axis)); // stop at the divider or midpoint
-    if (_lv_area_intersect(&source_area, draw_ctx->clip_area, &obj_area)) {
-      lv_area_copy(&dest_area,
-                   &source_area); // this is currently in absolute coordinates
-
-      // move to the upper left corner of the image itself rather than the obj
-      // location for the source
-      lv_area_move(&source_area, (lv_coord_t)(-left), (lv_coord_t)(-top));
-
-      // relativize to the upper left corner of the buffer area itself for the
-      // destination
-      lv_area_move(&dest_area, (lv_coord_t)(-draw_ctx->buf_area->x1),
-                   (lv_coord_t)(-draw_ctx->buf_area->y1));
-
-      copy_partial_image_flat(destination_buffer, buf_width, buf_height,
-                              dest_area, snapshot2, source_area);
+            from.header.cf == LV_IMG_CF_TRUE_COLOR);
+  LV_ASSERT((lv_img_cf_get_px_size(to.header.cf) >> 3) == sizeof(lv_color_t));
+  LV_ASSERT(from.header.w == frame.width && from.header.h == frame.height);
+  LV_ASSERT(to.header.w == from.header.w && to.header.h == from.header.h);
+
+  frame.before = {reinterpret_cast<const uint16_t *>(from.data), 0};
+  frame.after = {reinterpret_cast<const uint16_t *>(to.data), 0};
+  frame.before.bytes_read = &flip_external_bytes;
+  frame.after.bytes_read = &flip_external_bytes;
+  if (hot_buffer != nullptr) {
+    const int axis = flap_axis_y(frame.height);
+    const auto *hot = static_cast<const uint16_t *>(hot_buffer);
+    if (hot_bottom) {
+      frame.after.hot_pixels = hot;
+      frame.after.hot_first = axis;
+      frame.after.hot_last = frame.height - 1;
+    } else {
+      frame.before.hot_pixels = hot;
+      frame.before.hot_first = 0;
+      frame.before.hot_last = axis - 1;
     }
   }
+  kernel(frame);
+}
 
-  if (divider_y < axis) {
-    lv_area_t obj_area, dest_area;
-    lv_obj_get_coords(overlay, &obj_area);
-    lv_coord_t left = obj_area.x1;
-    lv_coord_t top = obj_area.y1;
-    obj_area.y1 = top + divider_y;
-    obj_area.y2 = top + axis - 3;
-
-    lv_area_t source_area = {
-        .x1 = 0,
-        .y1 = 0,
-        .x2 = static_cast<lv_coord_t>(snapshot1.header.w - 1),
-        .y2 = static_cast<lv_coord_t>(axis - 1)};
-
-    if (_lv_area_intersect(&dest_area, draw_ctx->clip_area, &obj_area)) {
-      // relativize to the upper left corner of the buffer area itself for the
-      // destination
-      lv_area_move(&dest_area, (lv_coord_t)(-draw_ctx->buf_area->x1),
-                   (lv_coord_t)(-draw_ctx->buf_area->y1));
-      lv_area_move(&obj_area, (lv_coord_t)(-draw_ctx->buf_area->x1),
-                   (lv_coord_t)(-draw_ctx->buf_area->y1));
-
-      copy_partial_image_perspective(destination_buffer, buf_width, buf_height,
-                                     dest_area, obj_area, snapshot1,
-                                     source_area, false);
-    }
+// A flip reads the half of a face in perspective a few rows short of once a
+// frame, and the rest of both faces about once a flip as the divider passes
+// over them. The half in perspective is the old face's top half until the
+// divider reaches the axis and the new face's bottom half after, so for the
+// length of the flip whichever one it is is read from a copy in internal
+// RAM, if there is a slot to spare for it.
+void flapper::stage_hot_rows() {
+  if (hot_rows == nullptr || kernel != transition_flip) {
+    return;
   }
 
-  // divider line
-  {
-    lv_area_t divider_area;
-    lv_obj_get_coords(overlay, &divider_area);
-    lv_area_move(&divider_area, 0, (lv_coord_t)(divider_y));
-    lv_area_set_height(&divider_area, 1);
-
-    lv_draw_rect_dsc_t divider_dsc;
-    lv_draw_rect_dsc_init(&divider_dsc);
-    divider_dsc.bg_color = lv_color_hex3(0x999);
-    lv_draw_rect(draw_ctx, &divider_dsc, &divider_area);
-
-    lv_area_move(&divider_area, 0, 1);
-    divider_dsc.bg_color = lv_color_hex3(0x333);
-    lv_draw_rect(draw_ctx, &divider_dsc, &divider_area);
-
-    lv_area_move(&divider_area, 0, 1);
-    divider_dsc.bg_color = lv_color_hex3(0x555);
-    lv_draw_rect(draw_ctx, &divider_dsc, &divider_area);
+  if (hot_buffer == nullptr) {
+    hot_buffer = hot_rows->try_acquire(FLAPPER_HOT_ROWS_SIZE);
+  }
+  if (hot_buffer == nullptr) {
+    return;
   }
 
-  if (divider_y > axis) {
-    lv_area_t obj_area, dest_area;
-    lv_obj_get_coords(overlay, &obj_area);
-    lv_coord_t top = obj_area.y1;
-    obj_area.y1 = top + axis;
-    obj_area.y2 = top + divider_y;
+  const lv_img_dsc_t &from = *from_image;
+  LV_ASSERT(from.header.w == LCD_WIDTH && from.header.h == LCD_HEIGHT);
+  const size_t row_size = from.header.w * sizeof(lv_color_t);
+  const size_t size = flap_axis_y(from.header.h) * row_size;
+  memcpy(hot_buffer, from.data, size);
+  hot_bottom = false;
+  flip_external_bytes += size;
+}
 
-    lv_area_t source_area = {
-        .x1 = 0,
-        .y1 = axis,
-        .x2 = static_cast<lv_coord_t>(snapshot1.header.w - 1),
-        .y2 = static_cast<lv_coord_t>(snapshot1.header.h - 1),
-    };
-
-    if (_lv_area_intersect(&dest_area, draw_ctx->clip_area, &obj_area)) {
-      // relativize to the upper left corner of the buffer area itself for the
-      // destination
-      lv_area_move(&dest_area, (lv_coord_t)(-draw_ctx->buf_area->x1),
-                   (lv_coord_t)(-draw_ctx->buf_area->y1));
-      lv_area_move(&obj_area, (lv_coord_t)(-draw_ctx->buf_area->x1),
-                   (lv_coord_t)(-draw_ctx->buf_area->y1));
-
-      copy_partial_image_perspective(destination_buffer, buf_width, buf_height,
-                                     dest_area, obj_area, snapshot2,
-                                     source_area, false);
-    }
+void flapper::stage_hot_bottom() {
+  if (hot_buffer == nullptr || hot_bottom) {
+    return;
   }
 
-  // bottom part
-  {
-    lv_area_t obj_area, source_area, dest_area;
-    lv_obj_get_coords(overlay, &obj_area);
-    lv_coord_t left = obj_area.x1;
-    lv_coord_t top = obj_area.y1;
-    obj_area.y1 =
-        (lv_coord_t)(obj_area.y1 + std::max(axis, (lv_coord_t)(divider_y + 3)));
-    if (_lv_area_intersect(&source_area, draw_ctx->clip_area, &obj_area)) {
-      lv_area_copy(&dest_area,
-                   &source_area); // this is currently in absolute coordinates
-
-      // move to the upper left corner of the image itself rather than the obj
-      // location for the source
-      lv_area_move(&source_area, (lv_coord_t)(-left), (lv_coord_t)(-top));
-
-      // relativize to the upper left corner of the buffer area itself for the
-      // destination
-      lv_area_move(&dest_area, (lv_coord_t)(-draw_ctx->buf_area->x1),
-                   (lv_coord_t)(-draw_ctx->buf_area->y1));
-
-      copy_partial_image_flat(destination_buffer, buf_width, buf_height,
-                              dest_area, snapshot1, source_area);
-    }
+  const lv_img_dsc_t &to = *to_image;
+  const size_t row_size = to.header.w * sizeof(lv_color_t);
+  const int axis = flap_axis_y(to.header.h);
+  const size_t size = (to.header.h - axis) * row_size;
+  LV_ASSERT(size <= FLAPPER_HOT_ROWS_SIZE);
+  memcpy(hot_buffer, to.data + axis * row_size, size);
+  hot_bottom = true;
+  flip_external_bytes += size;
+}
+
+void flapper::release_hot_rows() {
+  if (hot_buffer != nullptr) {
+    hot_rows->release(hot_buffer);
+    hot_buffer = nullptr;
   }
 }
 
+// lv_snapshot_take_to_buf, without allocating a draw context each time
+void flapper_snapshot(lv_obj_t *obj, lv_img_dsc_t *image, void *buffer) {
+  lv_obj_update_layout(obj);
+  LV_ASSERT(_lv_obj_get_ext_draw_size(obj) == 0);
+
+  lv_area_t area;
+  lv_obj_get_coords(obj, &area);
+  memset(buffer, 0, lv_area_get_size(&area) * sizeof(lv_color_t));
+
+  lv_disp_t *disp = lv_obj_get_disp(obj);
+  lv_disp_drv_t driver;
+  lv_disp_drv_init(&driver);
+  driver.hor_res = lv_disp_get_hor_res(disp);
+  driver.ver_res = lv_disp_get_ver_res(disp);
+
+  lv_disp_t fake_disp{};
+  fake_disp.driver = &driver;
+
+  LV_ASSERT(disp->driver->draw_ctx_size <= sizeof(render_draw_ctx));
+  lv_draw_ctx_t *draw_ctx = &render_draw_ctx.base_draw;
+  disp->driver->draw_ctx_init(&driver, draw_ctx);
+  driver.draw_ctx = draw_ctx;
+  draw_ctx->clip_area = &area;
+  draw_ctx->buf_area = &area;
+  draw_ctx->buf = buffer;
+
+  // as lv_snapshot does, drawing to a display of its own between refreshes
+  lv_disp_t *refreshing = _lv_refr_get_disp_refreshing();
+  _lv_refr_set_disp_refreshing(&fake_disp);
+  lv_obj_redraw(draw_ctx, obj);
+  _lv_refr_set_disp_refreshing(refreshing);
+
+  disp->driver->draw_ctx_deinit(&driver, draw_ctx);
+
+  *image = {};
+  image->header.w = lv_area_get_width(&area);
+  image->header.h = lv_area_get_height(&area);
+  image->header.cf = LV_IMG_CF_TRUE_COLOR;
+  image->data_size = lv_area_get_size(&area) * sizeof(lv_color_t);
+  image->data = static_cast<const uint8_t *>(buffer);
+}
+
 lv_coord_t flapper::compute_center_axis_y() const {
   lv_area_t content_area;
   lv_obj_get_coords(overlay, &content_area);
-  auto axis = (lv_coord_t)(lv_area_get_height(&content_area) / 2 - 4);
+  auto axis = (lv_coord_t)flap_axis_y(lv_area_get_height(&content_area));
   return axis;
 }
 
-void flapper::stop() { lv_anim_del(screen, nullptr); }
+void flapper::stop() { stop_animation(); }
+
+// As many frames as the last flip managed, or one every display refresh, of
+// the rows each frame redraws
+uint32_t flapper::estimated_bus_bytes(transition_kernel kernel) const {
+  uint32_t frames = stats.fps > 0
+                        ? static_cast<uint32_t>(stats.fps * FLIP_DURATION_MS /
+                                                1000)
+                        : FLIP_DURATION_MS / LV_DISP_DEF_REFR_PERIOD;
+  uint32_t frame_bytes = LCD_WIDTH * LCD_HEIGHT * sizeof(uint16_t);
+  if (kernel == transition_flip) {
+    frame_bytes /= 4; // between the axis and the divider, on average
+  }
+  if (FLIP_COLOR_MODE == LCD_COLOR_RGB444) {
+    frame_bytes = frame_bytes * 3 / 4;
+  }
+  return frames * frame_bytes;
+}
@@ -5,53 +5,129 @@
 
 #pragma once
 
+#include "drivers/lcds.h"
+#include "flap_kernels.h"
 #include "lvgl.h"
+#include "snapshot_pool.h"
+#include "transition_kernels.h"
+
+#include <array>
 
 using flapper_finished_callback = void (*)(void *user_data);
+// When a flip first drew a frame that moved, in LVGL ticks
+using flapper_motion_callback = void (*)(uint32_t tick_ms, void *user_data);
+
+struct flapper_frame_stats {
+  uint32_t frames;         // flip frames handed to LVGL to draw
+  uint32_t dropped_frames; // animation steps folded into a later frame
+  float fps;               // achieved over the last flip
+  // Read from faces in PSRAM or flash per frame of the last flip, and whether
+  // it read the half it reads most from internal RAM instead
+  uint32_t external_bytes_per_frame;
+  bool hot_rows_internal;
+};
+
+// The most a flip ever reads from hot rows at once: a face's bottom half,
+// which is the larger one
+constexpr size_t FLAPPER_HOT_ROWS_SIZE =
+    (LCD_HEIGHT - flap_axis_y(LCD_HEIGHT)) * LCD_WIDTH * sizeof(lv_color_t);
+
+// lv_snapshot_take_to_buf() of obj as a true color image, into a buffer of
+// lv_snapshot_buf_size_needed(), but without allocating anything
+void flapper_snapshot(lv_obj_t *obj, lv_img_dsc_t *image, void *buffer);
 
 class flapper {
 public:
-  explicit flapper(lv_obj_t *screen) {
-    this->screen = screen;
-  }
+  // hot_rows, if any, holds the half of a face flips read most, somewhere
+  // faster to read than the faces themselves
+  flapper(lv_obj_t *screen, snapshot_pool *snapshots,
+          snapshot_pool *hot_rows = nullptr);
 
+  // Snapshot the screen as it looks now, before and after changing it
   void before();
   void after();
+  // Or flip between prerendered images that outlive the flip
+  void before(const lv_img_dsc_t *image);
+  void after(const lv_img_dsc_t *image);
 
-  void start(bool last);
+  void start(bool last, transition_kernel kernel = transition_flip);
   void stop();
+  // Stops any flip and takes the overlay down, leaving the screen's objects
+  void clear() { cancel_existing_animation(); }
+  bool flipping() const { return animating; }
+  // Bytes a flip with kernel is expected to send the panel
+  uint32_t estimated_bus_bytes(transition_kernel kernel) const;
+  // Calls callback once, when the next flip to start draws its first frame
+  // that moves
+  void watch_motion(flapper_motion_callback callback, void *user_data) {
+    motion_callback = callback;
+    motion_callback_user_data = user_data;
+    motion_armed = true;
+  }
 
   ~flapper();
 
+  // Called on the timer pass after a flip ends or is stopped, unless another
+  // has been started by then
   void set_finished_callback(flapper_finished_callback callback, void *user_data) {
     this->finished_callback = callback;
     this->finished_callback_user_data = user_data;
   }
 
+  const flapper_frame_stats &frame_stats() const { return stats; }
+
 private:
+  void step();
   void animate(int32_t value);
+  void stop_animation();
   void animation_deleted();
+  bool overlay_shown() const;
+  void hide_overlay();
   void draw_overlay(lv_event_t *event);
   void cancel_existing_animation();
+  void stage_hot_rows();
+  void stage_hot_bottom();
+  void release_hot_rows();
 
   lv_obj_t *screen;
+  snapshot_pool *snapshots;
+  snapshot_pool *hot_rows;
+  void *hot_buffer{};
+  bool hot_bottom{}; // holding the new face's bottom half, not the old top
+  uint32_t flip_external_bytes{};
 
   lv_img_dsc_t snapshot1{};
   void *snapshot1_buffer{};
   lv_img_dsc_t snapshot2{};
   void *snapshot2_buffer{};
+  const lv_img_dsc_t *from_image{};
+  const lv_img_dsc_t *to_image{};
 
   lv_obj_t *overlay{};
-  lv_coord_t divider_y{};
-  lv_coord_t last_divider_y{};
+  lv_timer_t *animation_timer{};
+  lv_timer_t *finished_timer{};
+  // Only ever evaluated, for the progress a flip is at after act_time
+  lv_anim_t path{};
+  bool animating{};
+  transition_kernel kernel{transition_flip};
+  int32_t progress{};
+  int32_t last_progress{};
+  flapper_frame_stats stats{};
+  uint32_t flip_start_ms{};
+  uint32_t flip_frames{};
+  flapper_motion_callback motion_callback{};
+  void *motion_callback_user_data{};
+  bool motion_armed{};   // for the next flip to start
+  bool motion_watched{}; // this flip, which hasn't moved yet
+  uint32_t last_frame_ms{};
   flapper_finished_callback finished_callback{};
   void *finished_callback_user_data{};
   lv_coord_t compute_center_axis_y() const;
 
-  // TODO remove
-  void copy_partial_image_perspective(
-      uint8_t *destination_buffer, lv_coord_t buf_width, lv_coord_t buf_height,
-      const lv_area_t &dest_area, const lv_area_t &unclipped_dest_area,
-      const lv_img_dsc_t &source_image, const lv_area_t &source_area,
-      bool invert);
+  // Source row for each destination row of the flap half in perspective,
+  // out of the flip cache or else worked out once per animation frame, and
+  // shared by every strip LVGL draws that frame in
+  const int16_t *perspective_rows(const flap_perspective_key &key);
+  flap_perspective_key perspective_key{};
+  std::array<int16_t, LCD_HEIGHT> perspective_lut{};
 };
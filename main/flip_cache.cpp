@@ -0,0 +1,194 @@
+//  SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//  SPDX-License-Identifier: MIT
+
+#include "flip_cache.h"
+#include "drivers/cache_partition.h"
+
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+constexpr uint32_t FLIP_CACHE_MAGIC = 0x43504C46; // "FLPC"
+constexpr uint32_t FLIP_CACHE_VERSION = 1;
+
+// Laid out in the partition as
+//
+//   flip_cache_header, flip_cache_entry[image_count], faces, row maps
+//
+// with image_size bytes for each face. There is a set of row maps for the
+// half above the axis and one for the half below, each holding a map for
+// every height that half can be drawn at; the one d rows tall starts
+// d * (d - 1) / 2 entries into its set. The header is written last, so a
+// cache cut short by a reset never loads.
+struct flip_cache_header {
+  uint32_t magic;
+  uint32_t version;
+  uint8_t build_id[CACHE_PARTITION_BUILD_ID_SIZE];
+  uint32_t image_count;
+  uint32_t image_size;
+  uint32_t height;
+  uint32_t images_offset;
+  uint32_t rows_offset;
+  uint32_t total_size;
+};
+
+struct flip_cache_entry {
+  lv_img_header_t header;
+  uint32_t data_size;
+};
+
+constexpr size_t NUM_HALVES = 2;
+
+static const uint8_t *cache = nullptr; // mapped, once loaded
+static const flip_cache_header *loaded = nullptr;
+
+// The source rows of each half as flapper::draw_overlay draws them
+static flap_perspective_key half_key(size_t half, int height) {
+  int16_t axis = static_cast<int16_t>(flap_axis_y(height));
+  if (half == 0) {
+    return {.src_y1 = 0,
+            .src_y2 = static_cast<int16_t>(axis - 1),
+            .dest_height = 0,
+            .invert = false};
+  }
+  return {.src_y1 = axis,
+          .src_y2 = static_cast<int16_t>(height - 1),
+          .dest_height = 0,
+          .invert = false};
+}
+
+// Tallest the flap half gets: the bottom one runs a row past its source when
+// the divider lands on the bottom edge
+static int max_dest_height(const flap_perspective_key &key) {
+  return key.src_y2 - key.src_y1 + 2;
+}
+
+// Entries before the row map of the given height in the given half, or before
+// the half itself when dest_height is left at 1
+static size_t row_map_offset(size_t half, int height, int dest_height = 1) {
+  size_t offset = 0;
+  for (size_t previous = 0; previous < half; previous++) {
+    int set_height = max_dest_height(half_key(previous, height));
+    offset += set_height * (set_height + 1) / 2;
+  }
+  return offset + dest_height * (dest_height - 1) / 2;
+}
+
+static flip_cache_header layout(size_t image_count, size_t image_size,
+                                int height) {
+  flip_cache_header header{.magic = FLIP_CACHE_MAGIC,
+                           .version = FLIP_CACHE_VERSION,
+                           .build_id = {},
+                           .image_count = static_cast<uint32_t>(image_count),
+                           .image_size = static_cast<uint32_t>(image_size),
+                           .height = static_cast<uint32_t>(height),
+                           .images_offset = 0,
+                           .rows_offset = 0,
+                           .total_size = 0};
+  cache_partition_build_id(header.build_id);
+
+  size_t entries_end =
+      sizeof(flip_cache_header) + image_count * sizeof(flip_cache_entry);
+  header.images_offset = (entries_end + 3) & ~3;
+  header.rows_offset = header.images_offset + image_count * image_size;
+  header.total_size =
+      header.rows_offset + row_map_offset(NUM_HALVES, height) * sizeof(int16_t);
+  return header;
+}
+
+bool flip_cache_load(size_t image_count, size_t image_size, int height) {
+  cache = nullptr;
+  loaded = nullptr;
+
+  const flip_cache_header expected = layout(image_count, image_size, height);
+  if (expected.total_size > cache_partition_size()) {
+    return false;
+  }
+
+  const uint8_t *mapped = cache_partition_map(sizeof(flip_cache_header));
+  if (mapped == nullptr ||
+      memcmp(mapped, &expected, sizeof(flip_cache_header)) != 0) {
+    return false;
+  }
+
+  mapped = cache_partition_map(expected.total_size);
+  if (mapped == nullptr) {
+    return false;
+  }
+  cache = mapped;
+  loaded = reinterpret_cast<const flip_cache_header *>(mapped);
+  return true;
+}
+
+bool flip_cache_save(const sprite_atlas &atlas, size_t image_size,
+                     int height) {
+  const flip_cache_header header = layout(atlas.size(), image_size, height);
+  if (header.total_size > cache_partition_size() ||
+      !cache_partition_erase(header.total_size)) {
+    return false;
+  }
+  cache = nullptr; // erasing unmapped it
+  loaded = nullptr;
+
+  for (size_t i = 0; i < atlas.size(); i++) {
+    const lv_img_dsc_t *image = atlas.get(i);
+    assert(image->data_size <= image_size);
+
+    flip_cache_entry entry{.header = image->header,
+                           .data_size = image->data_size};
+    if (!cache_partition_write(sizeof(flip_cache_header) +
+                                   i * sizeof(flip_cache_entry),
+                               &entry, sizeof(entry)) ||
+        !cache_partition_write(header.images_offset + i * image_size,
+                               image->data, image->data_size)) {
+      return false;
+    }
+  }
+
+  std::vector<int16_t> rows(height);
+  for (size_t half = 0; half < NUM_HALVES; half++) {
+    flap_perspective_key key = half_key(half, height);
+    for (int dest_height = 1; dest_height <= max_dest_height(key);
+         dest_height++) {
+      key.dest_height = static_cast<int16_t>(dest_height);
+      flap_perspective_rows(key, 0, dest_height, rows.data());
+
+      size_t offset =
+          header.rows_offset +
+          row_map_offset(half, height, dest_height) * sizeof(int16_t);
+      if (!cache_partition_write(offset, rows.data(),
+                                 dest_height * sizeof(int16_t))) {
+        return false;
+      }
+    }
+  }
+
+  return cache_partition_write(0, &header, sizeof(header));
+}
+
+lv_img_dsc_t flip_cache_image(size_t index) {
+  assert(loaded != nullptr && index < loaded->image_count);
+
+  const auto *entries = reinterpret_cast<const flip_cache_entry *>(
+      cache + sizeof(flip_cache_header));
+  return {.header = entries[index].header,
+          .data_size = entries[index].data_size,
+          .data = cache + loaded->images_offset + index * loaded->image_size};
+}
+
+const int16_t *flip_cache_rows(const flap_perspective_key &key) {
+  if (loaded == nullptr || key.dest_height < 1) {
+    return nullptr;
+  }
+
+  int height = static_cast<int>(loaded->height);
+  for (size_t half = 0; half < NUM_HALVES; half++) {
+    flap_perspective_key cached = half_key(half, height);
+    cached.dest_height = key.dest_height;
+    if (key == cached && key.dest_height <= max_dest_height(cached)) {
+      return reinterpret_cast<const int16_t *>(cache + loaded->rows_offset) +
+             row_map_offset(half, height, key.dest_height);
+    }
+  }
+  return nullptr;
+}
@@ -0,0 +1,33 @@
+//  SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//  SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <lvgl.h>
+
+#include "flap_kernels.h"
+#include "sprite_atlas.h"
+
+// Flip assets that come out the same on every boot of a build: the faces in
+// the sprite atlas, and the row maps of the flap half in perspective at every
+// height it passes through. They are rendered once, written to the flipcache
+// partition and read straight out of mapped flash on later boots, so the
+// faces take neither PSRAM nor boot time and a flip frame is nothing but row
+// copies into the draw buffer. Anything the cache does not hold is still
+// worked out live.
+
+// Maps the cache if this build wrote it for image_count faces of image_size
+// bytes on panels `height` rows tall
+bool flip_cache_load(size_t image_count, size_t image_size, int height);
+
+// Writes out every face in atlas, along with the row maps for panels `height`
+// rows tall. Load it again to use it.
+bool flip_cache_save(const sprite_atlas &atlas, size_t image_size, int height);
+
+// A loaded face, its pixels left in flash
+lv_img_dsc_t flip_cache_image(size_t index);
+
+// The loaded row map for key, or nullptr if the cache holds none for it
+const int16_t *flip_cache_rows(const flap_perspective_key &key);
@@ -0,0 +1,115 @@
+//   SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//   SPDX-License-Identifier: MIT
+
+#include "flip_scheduler.h"
+
+#include <algorithm>
+#include <cassert>
+
+flip_scheduler::flip_scheduler(uint32_t bytes_per_second, uint32_t burst_bytes)
+    : bytes_per_second(bytes_per_second), burst_bytes(burst_bytes),
+      tokens(burst_bytes), refilled_ms(lv_tick_get()) {
+  assert(bytes_per_second > 0);
+  timer = lv_timer_create(
+      [](lv_timer_t *timer) {
+        static_cast<flip_scheduler *>(timer->user_data)->admit();
+      },
+      0, this);
+  lv_timer_pause(timer);
+}
+
+flip_scheduler::~flip_scheduler() { lv_timer_del(timer); }
+
+void flip_scheduler::request(size_t panel, uint32_t bus_bytes,
+                             flip_scheduler_callback start, void *user_data) {
+  assert(panel < queue.size());
+  if (!queue[panel].waiting) {
+    stats_.queue_depth++;
+    stats_.max_queue_depth =
+        std::max(stats_.max_queue_depth, stats_.queue_depth);
+  }
+  queue[panel] = {.waiting = true,
+                  .order = next_order++,
+                  .bus_bytes = bus_bytes,
+                  .requested_ms = lv_tick_get(),
+                  .start = start,
+                  .user_data = user_data};
+  if (!admitting) { // otherwise the admit() that started a step carries on
+    admit();
+  }
+}
+
+void flip_scheduler::cancel(size_t panel) {
+  assert(panel < queue.size());
+  if (queue[panel].waiting) {
+    queue[panel].waiting = false;
+    stats_.queue_depth--;
+  }
+}
+
+void flip_scheduler::set_budget(uint32_t bytes_per_second,
+                                uint32_t burst_bytes) {
+  assert(bytes_per_second > 0);
+  refill();
+  this->bytes_per_second = bytes_per_second;
+  this->burst_bytes = burst_bytes;
+  tokens = std::min<int64_t>(tokens, burst_bytes);
+  admit();
+}
+
+void flip_scheduler::reset_stats() {
+  stats_ = {.queue_depth = stats_.queue_depth,
+            .max_queue_depth = stats_.queue_depth};
+}
+
+void flip_scheduler::refill() {
+  uint32_t elapsed_ms = lv_tick_elaps(refilled_ms);
+  refilled_ms += elapsed_ms;
+  tokens = std::min<int64_t>(
+      tokens + static_cast<int64_t>(elapsed_ms) * bytes_per_second / 1000,
+      burst_bytes);
+}
+
+void flip_scheduler::admit() {
+  refill();
+  admitting = true;
+
+  while (true) {
+    // order wraps long after any step could still be waiting
+    pending_step *next = nullptr;
+    for (pending_step &step : queue) {
+      if (step.waiting &&
+          (next == nullptr || static_cast<int32_t>(step.order - next->order) <
+                                  0)) {
+        next = &step;
+      }
+    }
+    if (next == nullptr) {
+      lv_timer_pause(timer);
+      break;
+    }
+
+    int64_t needed = std::min(next->bus_bytes, burst_bytes);
+    if (tokens < needed) {
+      // come back once the bucket has refilled that far
+      auto wait_ms = static_cast<uint32_t>(
+          (needed - tokens) * 1000 / bytes_per_second + 1);
+      lv_timer_set_period(timer, wait_ms);
+      lv_timer_reset(timer);
+      lv_timer_resume(timer);
+      break;
+    }
+
+    tokens -= next->bus_bytes;
+    next->waiting = false;
+    uint32_t latency_ms = lv_tick_elaps(next->requested_ms);
+    stats_.queue_depth--;
+    stats_.admitted++;
+    stats_.total_latency_ms += latency_ms;
+    stats_.max_latency_ms = std::max(stats_.max_latency_ms, latency_ms);
+
+    next->start(next->user_data); // may ask for another step
+  }
+
+  admitting = false;
+}
@@ -0,0 +1,68 @@
+//   SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//   SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <lvgl.h>
+
+#include "drivers/lcds.h"
+
+using flip_scheduler_callback = void (*)(void *user_data);
+
+struct flip_scheduler_stats {
+  uint32_t admitted;         // steps started
+  uint32_t queue_depth;      // steps waiting now
+  uint32_t max_queue_depth;  // most steps waiting at once
+  uint32_t total_latency_ms; // summed wait of the admitted steps
+  uint32_t max_latency_ms;   // longest one of them waited
+};
+
+// Starts flap steps from every panel in the order they were asked for, but
+// only as fast as a token bucket of SPI bytes refills, so a wave of flips
+// can't ask more of the shared bus than the budget gives them. A step that
+// costs more than the bucket holds goes once the bucket is full.
+class flip_scheduler {
+public:
+  flip_scheduler(uint32_t bytes_per_second, uint32_t burst_bytes);
+  ~flip_scheduler();
+
+  flip_scheduler(flip_scheduler const &) = delete;
+  void operator=(const flip_scheduler &) = delete;
+
+  // Runs start once bus_bytes fit the budget and every step asked for before
+  // it has started, which may be straight away. A panel has one step waiting
+  // at most: asking again replaces it, at the back of the queue.
+  void request(size_t panel, uint32_t bus_bytes, flip_scheduler_callback start,
+               void *user_data);
+  void cancel(size_t panel);
+  void set_budget(uint32_t bytes_per_second, uint32_t burst_bytes);
+
+  const flip_scheduler_stats &stats() const { return stats_; }
+  void reset_stats();
+
+private:
+  struct pending_step {
+    bool waiting;
+    uint32_t order; // when it was asked for, relative to the others
+    uint32_t bus_bytes;
+    uint32_t requested_ms;
+    flip_scheduler_callback start;
+    void *user_data;
+  };
+
+  void refill();
+  void admit();
+
+  std::array<pending_step, NUM_LCDS> queue{};
+  uint32_t next_order{0};
+  uint32_t bytes_per_second;
+  uint32_t burst_bytes;
+  int64_t tokens; // bytes, negative while paying off a step over the burst
+  uint32_t refilled_ms;
+  bool admitting{false};
+  lv_timer_t *timer;
+  flip_scheduler_stats stats_{};
+};
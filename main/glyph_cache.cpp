@@ -0,0 +1,208 @@
+//  SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//  SPDX-License-Identifier: MIT
+
+#include "glyph_cache.h"
+#include "clock_face.h"
+#include "spiram_allocate.h"
+
+#include <algorithm>
+#include <array>
+
+// One for every glyph the clock draws: ":", 0-9 and the letters in the digit
+// font, and A, P and M in the AM/PM font, the blank symbols drawing nothing.
+// Tiles are kept until reboot, glyphs that can't have one are remembered as
+// such, and once the table is full any glyph not in it is left to LVGL
+// straight away.
+constexpr size_t GLYPH_CACHE_TILES =
+    (CLOCK_DIGIT_SYMBOLS.size() - 1) + CLOCK_LETTER_SYMBOLS.size() +
+    (CLOCK_AMPM_SYMBOLS.size() - 1) + 1;
+constexpr size_t GLYPH_CACHE_FONTS = 4;
+
+struct cached_glyph {
+  const lv_font_t *font;
+  uint32_t letter;
+  lv_color_t color;
+  bool tiled; // or left to LVGL
+  int16_t x;  // of the tile's top left from where LVGL places the letter
+  int16_t y;
+  glyph_tile tile;
+};
+
+static std::array<const lv_font_t *, GLYPH_CACHE_FONTS> fonts{};
+static size_t font_count = 0;
+static std::array<cached_glyph, GLYPH_CACHE_TILES> glyphs{};
+static size_t glyph_count = 0;
+static glyph_cache_stats stats{};
+static bool cache_enabled = true;
+
+static void (*lvgl_draw_ctx_init)(lv_disp_drv_t *, lv_draw_ctx_t *) = nullptr;
+static void (*lvgl_draw_letter)(lv_draw_ctx_t *, const lv_draw_label_dsc_t *,
+                                const lv_point_t *, uint32_t) = nullptr;
+
+static bool find_font(const lv_font_t *font) {
+  return std::find(fonts.begin(), fonts.begin() + font_count, font) !=
+         fonts.begin() + font_count;
+}
+
+// Its tile, as lv_draw_sw_letter would draw it, if the glyph can have one
+static bool build_tile(cached_glyph &glyph) {
+  const lv_font_t *font = glyph.font;
+  lv_font_glyph_dsc_t g;
+  if (!lv_font_get_glyph_dsc(font, &g, glyph.letter, '\0') ||
+      g.resolved_font != font || g.bpp != 4 ||
+      font->subpx != LV_FONT_SUBPX_NONE || g.box_w == 0 || g.box_h == 0 ||
+      g.box_w > UINT8_MAX) {
+    return false;
+  }
+  const uint8_t *bitmap = lv_font_get_glyph_bitmap(font, glyph.letter);
+  if (bitmap == nullptr) {
+    return false;
+  }
+
+  void *memory = spiram_allocate(glyph_tile_size(bitmap, g.box_w, g.box_h));
+  if (memory == nullptr) {
+    return false;
+  }
+
+  glyph.x = g.ofs_x;
+  glyph.y = (int16_t)((font->line_height - font->base_line) - g.box_h -
+                      g.ofs_y);
+  glyph_tile_build(glyph.tile, memory, bitmap, g.box_w, g.box_h,
+                   glyph.color.full);
+  return true;
+}
+
+// Takes the next entry for the glyph, tiled or not, so it is never tried
+// again; nullptr once the table is full
+static const cached_glyph *build_glyph(const lv_font_t *font, lv_color_t color,
+                                       uint32_t letter) {
+  if (glyph_count == glyphs.size()) {
+    return nullptr;
+  }
+
+  cached_glyph &glyph = glyphs[glyph_count++];
+  glyph = {};
+  glyph.font = font;
+  glyph.letter = letter;
+  glyph.color = color;
+  glyph.tiled = build_tile(glyph);
+  return &glyph;
+}
+
+static const cached_glyph *find_glyph(const lv_font_t *font, lv_color_t color,
+                                      uint32_t letter) {
+  for (size_t i = 0; i < glyph_count; i++) {
+    const cached_glyph &glyph = glyphs[i];
+    if (glyph.letter == letter && glyph.font == font &&
+        glyph.color.full == color.full) {
+      return &glyph;
+    }
+  }
+  return nullptr;
+}
+
+// find_glyph(), or build_glyph() if it isn't there yet; nullptr for a glyph
+// LVGL draws
+static const cached_glyph *lookup_glyph(const lv_font_t *font,
+                                        lv_color_t color, uint32_t letter) {
+  const cached_glyph *glyph = find_glyph(font, color, letter);
+  if (glyph == nullptr) {
+    glyph = build_glyph(font, color, letter);
+  }
+  if (glyph == nullptr || !glyph->tiled) {
+    stats.misses++;
+    return nullptr;
+  }
+  stats.hits++;
+  return glyph;
+}
+
+void glyph_cache_blit(const glyph_tile &tile, lv_coord_t x, lv_coord_t y,
+                      const lv_area_t &clip, lv_draw_ctx_t *draw_ctx) {
+  const lv_area_t *buf_area = draw_ctx->buf_area;
+  glyph_tile_blit(tile, x, y, {clip.x1, clip.y1, clip.x2, clip.y2},
+                  static_cast<uint16_t *>(draw_ctx->buf),
+                  {buf_area->x1, buf_area->y1, buf_area->x2, buf_area->y2},
+                  [](uint16_t color, uint16_t under, uint8_t opacity) {
+                    return lv_color_mix({.full = color}, {.full = under},
+                                        opacity)
+                        .full;
+                  });
+}
+
+static void draw_letter(lv_draw_ctx_t *draw_ctx,
+                        const lv_draw_label_dsc_t *dsc,
+                        const lv_point_t *pos_p, uint32_t letter) {
+  if (!cache_enabled || !find_font(dsc->font) || dsc->opa < LV_OPA_MAX ||
+      dsc->blend_mode != LV_BLEND_MODE_NORMAL) {
+    lvgl_draw_letter(draw_ctx, dsc, pos_p, letter);
+    return;
+  }
+
+  const cached_glyph *glyph = lookup_glyph(dsc->font, dsc->color, letter);
+  if (glyph == nullptr) {
+    lvgl_draw_letter(draw_ctx, dsc, pos_p, letter);
+    return;
+  }
+
+  lv_area_t area = {
+      .x1 = (lv_coord_t)(pos_p->x + glyph->x),
+      .y1 = (lv_coord_t)(pos_p->y + glyph->y),
+      .x2 = (lv_coord_t)(pos_p->x + glyph->x + glyph->tile.width - 1),
+      .y2 = (lv_coord_t)(pos_p->y + glyph->y + glyph->tile.height - 1)};
+  lv_area_t clipped;
+  if (!_lv_area_intersect(&clipped, &area, draw_ctx->clip_area)) {
+    return;
+  }
+  if (lv_draw_mask_is_any(&clipped)) {
+    lvgl_draw_letter(draw_ctx, dsc, pos_p, letter); // rounded corners and such
+    return;
+  }
+
+  glyph_cache_blit(glyph->tile, area.x1, area.y1, clipped, draw_ctx);
+}
+
+static void draw_ctx_init(lv_disp_drv_t *driver, lv_draw_ctx_t *draw_ctx) {
+  lvgl_draw_ctx_init(driver, draw_ctx);
+  // the displays all draw in software, with the same draw_letter
+  LV_ASSERT(lvgl_draw_letter == nullptr ||
+            lvgl_draw_letter == draw_ctx->draw_letter);
+  lvgl_draw_letter = draw_ctx->draw_letter;
+  draw_ctx->draw_letter = draw_letter;
+}
+
+void glyph_cache_install(lv_disp_drv_t *driver) {
+  static_assert(sizeof(lv_color_t) == sizeof(uint16_t));
+  if (driver->draw_ctx_init != draw_ctx_init) {
+    lvgl_draw_ctx_init = driver->draw_ctx_init;
+    driver->draw_ctx_init = draw_ctx_init;
+  }
+}
+
+void glyph_cache_add_font(const lv_font_t *font) {
+  if (find_font(font)) {
+    return;
+  }
+  LV_ASSERT(font_count < fonts.size());
+  fonts[font_count++] = font;
+}
+
+const glyph_tile *glyph_cache_tile(const lv_font_t *font, uint32_t letter,
+                                   lv_color_t color, lv_point_t *offset) {
+  if (!find_font(font)) {
+    return nullptr;
+  }
+  const cached_glyph *glyph = lookup_glyph(font, color, letter);
+  if (glyph == nullptr) {
+    return nullptr;
+  }
+  offset->x = glyph->x;
+  offset->y = glyph->y;
+  return &glyph->tile;
+}
+
+void glyph_cache_set_enabled(bool enabled) { cache_enabled = enabled; }
+
+glyph_cache_stats glyph_cache_get_stats() { return stats; }
+
+void glyph_cache_reset_stats() { stats = {}; }
@@ -0,0 +1,41 @@
+//  SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//  SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstdint>
+#include <lvgl.h>
+
+#include "glyph_tile.h"
+
+// Labels in the registered fonts are drawn from glyph tiles built the first
+// time each glyph is drawn in each colour, instead of LVGL decompressing the
+// glyph's bitmap and working out every pixel of it on every redraw. They come
+// out the same as LVGL's over any background. Anything else, or any glyph
+// drawn translucent or under a mask, goes to LVGL.
+
+struct glyph_cache_stats {
+  uint32_t hits;   // glyphs drawn from a tile
+  uint32_t misses; // glyphs LVGL drew instead
+};
+
+// Hooks the display driver's draw contexts, including the ones snapshots
+// render with. Call before registering the driver.
+void glyph_cache_install(lv_disp_drv_t *driver);
+void glyph_cache_add_font(const lv_font_t *font);
+
+// The tile letter is drawn from in a registered font and color, built if need
+// be, and where its top left goes from where LVGL would place the letter;
+// nullptr if it can't be cached
+const glyph_tile *glyph_cache_tile(const lv_font_t *font, uint32_t letter,
+                                   lv_color_t color, lv_point_t *offset);
+
+// Draws tile with its top left at x, y, inside clip, as LVGL would have
+void glyph_cache_blit(const glyph_tile &tile, lv_coord_t x, lv_coord_t y,
+                      const lv_area_t &clip, lv_draw_ctx_t *draw_ctx);
+
+// While false, labels leave every glyph to LVGL, to check the tiles against
+void glyph_cache_set_enabled(bool enabled);
+
+glyph_cache_stats glyph_cache_get_stats();
+void glyph_cache_reset_stats();
@@ -0,0 +1,150 @@
+//  SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//  SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+// A 4bpp font glyph split once into runs of the pixels it covers fully and
+// runs of its antialiased edges. Drawing it again fills the first with its
+// colour and blends the second into whatever is underneath by their opacity,
+// the way LVGL blends a letter, instead of decoding and working out every
+// pixel. Pixels it doesn't cover at all are left out of the runs and keep
+// whatever is under them.
+
+struct glyph_run {
+  uint8_t x;
+  uint8_t length;
+  bool edge; // blended by opacity, rather than filled
+};
+
+struct glyph_tile {
+  int width;
+  int height;
+  uint16_t color;
+  uint16_t *row_runs; // index of each row's first run, then the run count
+  glyph_run *runs;
+  uint8_t *opacity; // width * height, as LVGL's letter mask would have it
+};
+
+// Inclusive corners, like lv_area_t
+struct glyph_area {
+  int x1;
+  int y1;
+  int x2;
+  int y2;
+};
+
+// Packed 4bpp, rows not padded to a byte, high nibble first: how LVGL's font
+// converter stores glyphs and how LVGL hands them back decompressed
+inline uint8_t glyph_alpha4(const uint8_t *bitmap, int index) {
+  return (bitmap[index >> 1] >> ((index & 1) ? 0 : 4)) & 0xF;
+}
+
+// Calls run(x, length, edge) for each run of row y of the glyph, in order
+template <typename Run>
+void glyph_for_each_run(const uint8_t *bitmap, int width, int y, Run run) {
+  int start = 0;
+  int length = 0;
+  bool edge = false;
+  for (int x = 0; x <= width; x++) {
+    uint8_t alpha = x < width ? glyph_alpha4(bitmap, y * width + x) : 0;
+    bool pixel_edge = alpha < 0xF;
+    if (length > 0 && (alpha == 0 || pixel_edge != edge ||
+                       length == UINT8_MAX)) {
+      run(start, length, edge);
+      length = 0;
+    }
+    if (alpha != 0) {
+      if (length == 0) {
+        start = x;
+        edge = pixel_edge;
+      }
+      length++;
+    }
+  }
+}
+
+inline size_t glyph_run_count(const uint8_t *bitmap, int width, int height) {
+  size_t count = 0;
+  for (int y = 0; y < height; y++) {
+    glyph_for_each_run(bitmap, width, y, [&](int, int, bool) { count++; });
+  }
+  return count;
+}
+
+// Bytes glyph_tile_build() needs for the glyph
+inline size_t glyph_tile_size(const uint8_t *bitmap, int width, int height) {
+  return (height + 1) * sizeof(uint16_t) +
+         glyph_run_count(bitmap, width, height) * sizeof(glyph_run) +
+         width * height;
+}
+
+// Lays the tile out in memory, glyph_tile_size() bytes of it, to be drawn in
+// color. Glyphs can be up to 255 pixels wide.
+inline void glyph_tile_build(glyph_tile &tile, void *memory,
+                             const uint8_t *bitmap, int width, int height,
+                             uint16_t color) {
+  auto *bytes = static_cast<uint8_t *>(memory);
+  tile.width = width;
+  tile.height = height;
+  tile.color = color;
+  tile.row_runs = reinterpret_cast<uint16_t *>(bytes);
+  bytes += (height + 1) * sizeof(uint16_t);
+  tile.runs = reinterpret_cast<glyph_run *>(bytes);
+  bytes += glyph_run_count(bitmap, width, height) * sizeof(glyph_run);
+  tile.opacity = bytes;
+
+  size_t run = 0;
+  for (int y = 0; y < height; y++) {
+    tile.row_runs[y] = static_cast<uint16_t>(run);
+    glyph_for_each_run(bitmap, width, y, [&](int x, int length, bool edge) {
+      tile.runs[run++] = {static_cast<uint8_t>(x),
+                          static_cast<uint8_t>(length), edge};
+    });
+    for (int x = 0; x < width; x++) {
+      // _lv_bpp4_opa_table
+      tile.opacity[y * width + x] =
+          static_cast<uint8_t>(glyph_alpha4(bitmap, y * width + x) * 17);
+    }
+  }
+  tile.row_runs[height] = static_cast<uint16_t>(run);
+}
+
+// Draws the tile with its top left at x, y, inside clip, into dest, which
+// covers dest_area. Edge pixels are mix(color, pixel underneath, opacity),
+// which for LVGL's own result is lv_color_mix.
+template <typename Mix>
+void glyph_tile_blit(const glyph_tile &tile, int x, int y,
+                     const glyph_area &clip, uint16_t *dest,
+                     const glyph_area &dest_area, Mix mix) {
+  const int dest_width = dest_area.x2 - dest_area.x1 + 1;
+  const int first_row = std::max(clip.y1 - y, 0);
+  const int last_row = std::min(clip.y2 - y, tile.height - 1);
+  const int first_col = std::max(clip.x1 - x, 0);
+  const int last_col = std::min(clip.x2 - x, tile.width - 1);
+
+  for (int row = first_row; row <= last_row; row++) {
+    uint16_t *dest_row = dest + (y + row - dest_area.y1) * dest_width;
+    const uint8_t *opacity = tile.opacity + row * tile.width;
+
+    for (int i = tile.row_runs[row]; i < tile.row_runs[row + 1]; i++) {
+      const glyph_run &run = tile.runs[i];
+      int start = std::max<int>(run.x, first_col);
+      int end = std::min(run.x + run.length - 1, last_col);
+      if (start > end) {
+        continue;
+      }
+      uint16_t *pixel = dest_row + (x + start - dest_area.x1);
+      if (!run.edge) {
+        std::fill_n(pixel, end - start + 1, tile.color);
+        continue;
+      }
+      for (int col = start; col <= end; col++, pixel++) {
+        *pixel = mix(tile.color, *pixel, opacity[col]);
+      }
+    }
+  }
+}
@@ -2,60 +2,229 @@
 //  SPDX-License-Identifier: MIT
 
 #include "gui.h"
+#include "display_refresh.h"
+#include "drivers/lcd_shadow.h"
 #include "drivers/lcds.h"
+#include "glyph_cache.h"
+#include "spiram_allocate.h"
+#include "spsc_ring.h"
 
-#include <esp_attr.h>
-#include <esp_event.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include <esp_heap_caps.h>
 #include <esp_log.h>
 #include <esp_timer.h>
 
 #include <lvgl.h>
 
-ESP_EVENT_DECLARE_BASE(GUI_EVENTS);
+#include <algorithm>
+#include <atomic>
 
-enum {
-  GUI_EVENT_TIMER,
-};
+// LVGL renders on core 1 while the flush task drives the bus from core 0, so
+// one strip goes out while the next is being drawn
+constexpr BaseType_t GUI_TASK_CORE = 1;
+constexpr UBaseType_t GUI_TASK_PRIORITY = 5;
+constexpr uint32_t GUI_TASK_STACK_SIZE = 7168;
+constexpr BaseType_t FLUSH_TASK_CORE = 0;
+constexpr UBaseType_t FLUSH_TASK_PRIORITY = 6;
+constexpr uint32_t FLUSH_TASK_STACK_SIZE = 4096;
+constexpr size_t FLUSH_RING_SIZE = 32; // two strips in flight plus commands
+constexpr UBaseType_t GUI_WORK_QUEUE_SIZE = 16;
+// The GUI task's notification slot for flushes finishing, its own so nothing
+// else given to or taken from the task's default slot can swallow one
+constexpr UBaseType_t GUI_NOTIFY_FLUSHED = 1;
+static_assert(GUI_NOTIFY_FLUSHED < configTASK_NOTIFICATION_ARRAY_ENTRIES,
+              "CONFIG_FREERTOS_TASK_NOTIFICATION_ARRAY_ENTRIES is too small");
+constexpr int64_t WAKEUP_WINDOW_US = 10 * 1000 * 1000;
+constexpr uint32_t STATS_LOG_PERIOD_MS = 60 * 1000;
 
 constexpr auto BUFFER_ROWS =
     LCD_SPI_MAX_TRANSFER_SIZE / LCD_WIDTH / sizeof(uint16_t);
 constexpr auto PIXEL_BUFFER_SIZE_PX = LCD_WIDTH * BUFFER_ROWS;
+// two 25 row strips for each of the six displays, as the buffers used to be
+constexpr size_t PER_DISPLAY_BUFFERS_SIZE = NUM_LCDS * 2 * LCD_WIDTH * 25 * 2;
+
+// Diff flushes against a PSRAM copy of each panel and only send what changed
+constexpr bool USE_SHADOW_FRAMEBUFFERS = false;
 
-static DMA_ATTR uint16_t lcd_buffers[NUM_LCDS][PIXEL_BUFFER_SIZE_PX];
-static lv_disp_draw_buf_t draw_buffers[NUM_LCDS];
+// The panels share one bus and LVGL refreshes displays one after another, so
+// every display draws into the same pair of strips: one is rendered while
+// the other is on the bus, whichever display it belongs to.
+static lv_disp_draw_buf_t shared_draw_buffer;
 static lv_disp_drv_t display_drivers[NUM_LCDS];
 static lv_disp_t *displays[NUM_LCDS];
 
 struct driver_user_data {
   size_t display_index;
+  uint8_t cs_mask; // panels this display's flushes are sent to
+  lcd_color_mode color_mode;
+  uint32_t frames_queued;               // by the GUI task
+  std::atomic<uint32_t> frames_flushed; // once their last strip is out
 };
 
 static struct driver_user_data driver_user_datas[NUM_LCDS];
-static esp_timer_handle_t lv_timer_handle;
+
+struct gui_work {
+  gui_work_cb callback;
+  void *user_data;
+};
+
+// Everything that reaches the panels goes through the flush ring, in order,
+// so the flush task is the only one ever touching the bus
+enum flush_request_type {
+  FLUSH_REQUEST_BLIT,
+  FLUSH_REQUEST_COLOR_MODE,
+  FLUSH_REQUEST_INVALIDATE_SHADOW,
+};
+
+struct flush_request {
+  flush_request_type type;
+  uint8_t cs_mask;
+  lv_disp_drv_t *driver;
+  lv_area_t area;
+  uint16_t *pixels;
+  bool last_of_frame;
+  lcd_color_mode color_mode;
+};
+
+static spsc_ring<flush_request, FLUSH_RING_SIZE> flush_ring;
+static TaskHandle_t gui_task_handle;
+static TaskHandle_t flush_task_handle;
+
+static QueueHandle_t work_queue;
+static uint32_t wakeups = 0;
+static int64_t wakeup_window_start_us = 0;
+static float wakeups_per_second = 0;
+
+static void push_flush_request(const flush_request &request) {
+  while (!flush_ring.push(request)) {
+    vTaskDelay(1); // ring full, let the flush task catch up
+  }
+  xTaskNotifyGive(flush_task_handle);
+}
+
+static void flush_done(void *driver) {
+  // runs in the SPI interrupt, or on the flush task if nothing changed
+  lv_disp_flush_ready(static_cast<lv_disp_drv_t *>(driver));
+
+  if (xPortInIsrContext()) {
+    BaseType_t higher_priority_task_woken = pdFALSE;
+    vTaskNotifyGiveIndexedFromISR(gui_task_handle, GUI_NOTIFY_FLUSHED,
+                                  &higher_priority_task_woken);
+    portYIELD_FROM_ISR(higher_priority_task_woken);
+  } else {
+    xTaskNotifyGiveIndexed(gui_task_handle, GUI_NOTIFY_FLUSHED);
+  }
+}
+
+static void frame_flush_done(void *driver) {
+  auto *user_data = static_cast<driver_user_data *>(
+      static_cast<lv_disp_drv_t *>(driver)->user_data);
+  user_data->frames_flushed.fetch_add(1, std::memory_order_release);
+  flush_done(driver);
+}
+
+static void flush_task([[maybe_unused]] void *arg) {
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    flush_request request{};
+    while (flush_ring.pop(&request)) {
+      switch (request.type) {
+      case FLUSH_REQUEST_BLIT:
+        lcd_shadow_blit_rect_async(
+            request.cs_mask, request.area.x1, request.area.y1,
+            lv_area_get_width(&request.area), lv_area_get_height(&request.area),
+            request.pixels,
+            request.last_of_frame ? frame_flush_done : flush_done,
+            request.driver);
+        break;
+      case FLUSH_REQUEST_COLOR_MODE:
+        lcd_set_color_mode(request.cs_mask, request.color_mode);
+        break;
+      case FLUSH_REQUEST_INVALIDATE_SHADOW:
+        lcd_shadow_invalidate(request.cs_mask);
+        break;
+      }
+    }
+  }
+}
 
 static void flush_cb(lv_disp_drv_t *disp_drv, const lv_area_t *area,
                      lv_color_t *color_p) {
   auto *user_data = static_cast<driver_user_data *>(disp_drv->user_data);
-  lcd_select(user_data->display_index);
-  lcd_blit_rect(area->x1, area->y1, area->x2 - area->x1 + 1,
-                area->y2 - area->y1 + 1, (const uint16_t *)color_p,
-                (area->x2 - area->x1 + 1) * (area->y2 - area->y1 + 1) *
-                    sizeof(lv_color_t));
-  lv_disp_flush_ready(disp_drv);
-}
-
-static void timer_callback([[maybe_unused]] void *arg) {
-  esp_err_t err = esp_event_post(GUI_EVENTS, GUI_EVENT_TIMER, nullptr, 0, 10);
-  if (err != ESP_ERR_TIMEOUT) { // this is ok if we're busy
-    ESP_ERROR_CHECK(err);
+  bool last_of_frame = lv_disp_flush_is_last(disp_drv);
+  if (last_of_frame) {
+    user_data->frames_queued++;
+  }
+  push_flush_request({.type = FLUSH_REQUEST_BLIT,
+                      .cs_mask = user_data->cs_mask,
+                      .driver = disp_drv,
+                      .area = *area,
+                      .pixels = (uint16_t *)color_p,
+                      .last_of_frame = last_of_frame});
+}
+
+// LVGL calls this while the other draw buffer is still being sent; sleep
+// until a flush completes instead of spinning on core 1
+static void wait_cb([[maybe_unused]] lv_disp_drv_t *disp_drv) {
+  ulTaskNotifyTakeIndexed(GUI_NOTIFY_FLUSHED, pdTRUE, 1);
+}
+
+static void count_wakeup() {
+  wakeups++;
+
+  int64_t now = esp_timer_get_time();
+  int64_t elapsed = now - wakeup_window_start_us;
+  if (elapsed >= WAKEUP_WINDOW_US) {
+    wakeups_per_second = wakeups * 1000000.0f / elapsed;
+    wakeups = 0;
+    wakeup_window_start_us = now;
   }
 }
 
-static void timer_event_handler([[maybe_unused]] void *handler_args,
-                                [[maybe_unused]] esp_event_base_t base,
-                                [[maybe_unused]] int32_t id,
-                                [[maybe_unused]] void *event_data) {
-  lv_timer_handler();
+// Sleeps until LVGL's next timer is due or someone posts work, whichever
+// comes first, instead of polling on a fixed period. With nothing to redraw
+// the refresh timers are paused, so that can be the next minute, or never.
+static void gui_task([[maybe_unused]] void *arg) {
+  uint32_t sleep_ms = 0;
+
+  while (true) {
+    TickType_t timeout = sleep_ms == LV_NO_TIMER_READY
+                             ? portMAX_DELAY
+                             : std::max<TickType_t>(pdMS_TO_TICKS(sleep_ms), 1);
+
+    gui_work work{};
+    if (xQueueReceive(work_queue, &work, timeout) == pdTRUE) {
+      do {
+        work.callback(work.user_data);
+      } while (xQueueReceive(work_queue, &work, 0) == pdTRUE);
+    }
+
+    count_wakeup();
+    sleep_ms = display_refresh_timer_handler();
+  }
+}
+
+static void init_draw_buffers() {
+  constexpr uint32_t caps = MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL;
+  constexpr size_t buffer_size = PIXEL_BUFFER_SIZE_PX * sizeof(lv_color_t);
+
+  void *buffer1 = heap_caps_malloc(buffer_size, caps);
+  void *buffer2 = heap_caps_malloc(buffer_size, caps);
+  assert(buffer1 != nullptr && buffer2 != nullptr);
+  lv_disp_draw_buf_init(&shared_draw_buffer, buffer1, buffer2,
+                        PIXEL_BUFFER_SIZE_PX);
+
+  // with per-display buffers the same heap would have had this much less
+  size_t free_now = heap_caps_get_free_size(caps);
+  size_t free_before = free_now + 2 * buffer_size - PER_DISPLAY_BUFFERS_SIZE;
+  ESP_LOGI("gui",
+           "draw buffers: 2 x %u bytes shared by all displays, internal DMA "
+           "RAM free %u (%u with per-display buffers), largest block %u",
+           buffer_size, free_now, free_before,
+           heap_caps_get_largest_free_block(caps));
 }
 
 static void log_cb(const char *buf) {
@@ -69,50 +238,119 @@ void gui_init() {
 
   lv_init();
 
+  if (USE_SHADOW_FRAMEBUFFERS) {
+    lcd_shadow_init();
+  }
+
+  init_draw_buffers();
+
   for (size_t i = 0; i < NUM_LCDS; i++) {
-    lv_disp_draw_buf_init(&draw_buffers[i], lcd_buffers[i], nullptr,
-                          PIXEL_BUFFER_SIZE_PX);
     lv_disp_drv_t *driver = &display_drivers[i];
     lv_disp_drv_init(driver);
-    driver->draw_buf = &draw_buffers[i];
+    driver->draw_buf = &shared_draw_buffer;
     driver->hor_res = LCD_WIDTH;
     driver->ver_res = LCD_HEIGHT;
     driver->flush_cb = flush_cb;
+    driver->wait_cb = wait_cb;
 
     struct driver_user_data *user_data = &driver_user_datas[i];
     user_data->display_index = i;
+    user_data->cs_mask = 1 << i;
+    user_data->color_mode = LCD_COLOR_RGB565;
 
     driver->user_data = user_data;
 
+    glyph_cache_install(driver);
     displays[i] = lv_disp_drv_register(driver);
+    display_refresh_install(displays[i]);
   }
 
-  esp_timer_create_args_t timer_args = {
-      .callback = timer_callback,
-      .arg = nullptr,
-      .dispatch_method = ESP_TIMER_TASK,
-      .name = "lv_timer",
-      .skip_unhandled_events = true,
-  };
+  lv_timer_create(
+      [](lv_timer_t *) {
+        glyph_cache_stats glyphs = glyph_cache_get_stats();
+        ESP_LOGI("gui",
+                 "%.2f wakeups/s, %u PSRAM allocations since boot, %lu glyph "
+                 "cache hits and %lu misses",
+                 gui_get_wakeups_per_second(), spiram_allocation_count(),
+                 glyphs.hits, glyphs.misses);
+        glyph_cache_reset_stats();
+      },
+      STATS_LOG_PERIOD_MS, nullptr);
+
+  work_queue = xQueueCreate(GUI_WORK_QUEUE_SIZE, sizeof(gui_work));
+  assert(work_queue != nullptr);
+  wakeup_window_start_us = esp_timer_get_time();
 
-  ESP_ERROR_CHECK(esp_event_handler_instance_register(
-      GUI_EVENTS, GUI_EVENT_TIMER, timer_event_handler, nullptr, nullptr));
+  BaseType_t result = xTaskCreatePinnedToCore(
+      flush_task, "lcd_flush", FLUSH_TASK_STACK_SIZE, nullptr,
+      FLUSH_TASK_PRIORITY, &flush_task_handle, FLUSH_TASK_CORE);
+  assert(result == pdPASS);
 
-  ESP_ERROR_CHECK(esp_timer_create(&timer_args, &lv_timer_handle));
-  ESP_ERROR_CHECK(esp_timer_start_periodic(lv_timer_handle, 5000));
+  result = xTaskCreatePinnedToCore(gui_task, "gui", GUI_TASK_STACK_SIZE,
+                                   nullptr, GUI_TASK_PRIORITY, &gui_task_handle,
+                                   GUI_TASK_CORE);
+  assert(result == pdPASS);
 }
 
+void gui_post(gui_work_cb callback, void *user_data) {
+  gui_work work = {.callback = callback, .user_data = user_data};
+  BaseType_t result = xQueueSend(work_queue, &work, portMAX_DELAY);
+  assert(result == pdTRUE);
+}
+
+float gui_get_wakeups_per_second() { return wakeups_per_second; }
+
 lv_disp_t *gui_get_display(size_t index) {
   assert(lv_is_initialized());
   assert(index < NUM_LCDS);
   return displays[index];
 }
 
+void gui_broadcast_refresh(size_t leader, uint8_t mask) {
+  assert(leader < NUM_LCDS);
+  struct driver_user_data *user_data = &driver_user_datas[leader];
+
+  user_data->cs_mask = mask | (1 << leader);
+  lv_refr_now(displays[leader]);
+  user_data->cs_mask = 1 << leader;
+
+  // the followers already received the leader's pixels
+  for (size_t i = 0; i < NUM_LCDS; i++) {
+    if (i != leader && (mask & (1 << i))) {
+      _lv_inv_area(displays[i], nullptr);
+    }
+  }
+}
+
+void gui_set_color_mode(lv_disp_t *display, lcd_color_mode mode) {
+  auto *user_data = static_cast<driver_user_data *>(display->driver->user_data);
+  if (user_data->color_mode == mode) {
+    return;
+  }
+
+  user_data->color_mode = mode;
+  push_flush_request({.type = FLUSH_REQUEST_COLOR_MODE,
+                      .cs_mask = user_data->cs_mask,
+                      .color_mode = mode});
+  if (mode == LCD_COLOR_RGB565) {
+    push_flush_request({.type = FLUSH_REQUEST_INVALIDATE_SHADOW,
+                        .cs_mask = user_data->cs_mask});
+    lv_obj_invalidate(lv_disp_get_scr_act(display));
+  }
+}
+
+bool gui_frame_in_flight(lv_disp_t *display) {
+  auto *user_data = static_cast<driver_user_data *>(display->driver->user_data);
+  return user_data->frames_flushed.load(std::memory_order_acquire) !=
+         user_data->frames_queued;
+}
+
 void gui_invalidate_all_screens() {
+  // resend everything, not just changes
+  push_flush_request({.type = FLUSH_REQUEST_INVALIDATE_SHADOW,
+                      .cs_mask = LCD_ALL_MASK});
   for (auto *display : displays) {
     lv_obj_t *screen = lv_disp_get_scr_act(display);
     lv_obj_invalidate(screen);
   }
 }
-
-ESP_EVENT_DEFINE_BASE(GUI_EVENTS);
@@ -5,9 +5,28 @@
 
 #include <lvgl.h>
 
+#include "drivers/lcds.h"
+
+using gui_work_cb = void (*)(void *user_data);
+
+// Starts the GUI task, which from then on owns LVGL and the panels
 void gui_init();
+// Runs callback on the GUI task. Anything touching LVGL from another task
+// has to go through here.
+void gui_post(gui_work_cb callback, void *user_data);
+// How often the GUI task woke up, averaged over the last ten seconds
+float gui_get_wakeups_per_second();
 lv_disp_t *gui_get_display(size_t index);
 void gui_invalidate_all_screens();
+// Renders `leader` now and sends its pixels to every panel in `mask` at once.
+// Only valid when those screens currently look identical.
+void gui_broadcast_refresh(size_t leader, uint8_t mask);
+// Changes how many bits per pixel the display's panel is sent. Going back to
+// RGB565 repaints the whole screen at full depth.
+void gui_set_color_mode(lv_disp_t *display, lcd_color_mode mode);
+// Whether the last frame rendered for display is still on its way to the
+// panel
+bool gui_frame_in_flight(lv_disp_t *display);
 
 LV_FONT_DECLARE(oswald_40)
 LV_FONT_DECLARE(oswald_60)
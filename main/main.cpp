@@ -19,6 +19,7 @@
 #include "led_manager.h"
 #include "rtc.h"
 #include "webserver.h"
+#include "webhook_text.h"
 
 #define SPIFFS_MOUNTPOINT_NO_SLASH "/spiffs"
 #define SPIFFS_MOUNTPOINT SPIFFS_MOUNTPOINT_NO_SLASH "/"
@@ -27,6 +28,8 @@ static const auto TAG = "previoustube";
 
 static const auto SNTP_SERVER = "pool.ntp.org";
 
+constexpr uint32_t FLIP_STATS_PERIOD_MS = 60 * 1000;
+
 ESP_EVENT_DECLARE_BASE(DISPATCH_EVENTS);
 enum {
   DISPATCH_EVENT_TIME_CHANGED,
@@ -113,6 +116,69 @@ void button_tapped(touchpad_button_t button) {
   }
 }
 
+// Touch, SNTP and webhook events arrive on the default event loop; everything
+// they lead to touches LVGL, so it is handed over to the GUI task.
+void post_button_tapped(touchpad_button_t button) {
+  gui_post(
+      [](void *user_data) {
+        button_tapped(static_cast<touchpad_button_t>(
+            reinterpret_cast<intptr_t>(user_data)));
+      },
+      reinterpret_cast<void *>(static_cast<intptr_t>(button)));
+}
+
+void post_clock_update() {
+  gui_post([](void *) { clock::get().update(); }, nullptr);
+}
+
+void log_flip_stats() {
+  for (size_t i = 0; i < NUM_LCDS; i++) {
+    const flapper_frame_stats &stats = clock::get().frame_stats(i);
+    ESP_LOGI(TAG,
+             "panel %u: %lu flip frames, %lu dropped, %.1f fps and %lu "
+             "external bytes a frame last flip (%s hot rows)",
+             i, stats.frames, stats.dropped_frames, stats.fps,
+             stats.external_bytes_per_frame,
+             stats.hot_rows_internal ? "internal" : "no");
+  }
+
+  flip_scheduler &scheduler = clock::get().scheduler();
+  const flip_scheduler_stats &stats = scheduler.stats();
+  ESP_LOGI(TAG,
+           "flip scheduler: %lu steps admitted, %lu waiting (at most %lu), "
+           "%lu ms mean and %lu ms max admission latency",
+           stats.admitted, stats.queue_depth, stats.max_queue_depth,
+           stats.admitted > 0 ? stats.total_latency_ms / stats.admitted : 0,
+           stats.max_latency_ms);
+  scheduler.reset_stats();
+
+  ESP_LOGI(TAG, "last minute's first flap moved %lu ms after it turned over",
+           clock::get().boundary_latency_ms());
+
+  for (size_t i = 0; i < NUM_LCDS; i++) {
+    const digit_ticker_stats &stats = clock::get().ticker_stats(i);
+    if (stats.steps == 0) {
+      continue;
+    }
+    ESP_LOGI(TAG,
+             "panel %u ticker: %lu steps (%lu late), %lu frames, %lu ms max "
+             "step and %lu ms max between frames",
+             i, stats.steps, stats.late_steps, stats.frames, stats.max_step_ms,
+             stats.max_frame_ms);
+  }
+  clock::get().reset_ticker_stats();
+
+  webhook_text_stats webhooks = webhook_text_get_stats();
+  if (webhooks.received > 0) {
+    ESP_LOGI(TAG,
+             "webhook: %lu bodies, %lu coalesced, %lu shown, %lu ms max to "
+             "show one",
+             webhooks.received, webhooks.coalesced, webhooks.applied,
+             webhooks.max_apply_ms);
+  }
+  webhook_text_reset_stats();
+}
+
 void nvs_init() {
   esp_err_t ret = nvs_flash_init();
   if (ret == ESP_ERR_NVS_NO_FREE_PAGES ||
@@ -138,13 +204,13 @@ void ntp_changed_time(struct timeval *tv) {
   ESP_LOGI(TAG, "Time changed: %lld", tv->tv_sec);
 
   rtc_persist();
-  clock::get().update();
+  post_clock_update();
 }
 
 void rtc_loaded_time(struct timeval *tv) {
   ESP_LOGI(TAG, "Time loaded: %lld", tv->tv_sec);
 
-  clock::get().update();
+  post_clock_update();
 }
 
 void sntp_init() {
@@ -230,12 +296,17 @@ void blink_led(size_t led_index, uint8_t color_r, uint8_t color_g,
   assert(cleanup_delay > blink_interval * toggles);
 }
 
-void webhook_handler(const uint8_t *buffer, size_t length) {
-  ESP_LOGI(TAG, "Webhook received: enabled? %d", blinks_enabled);
+void show_webhook() {
+  // a burst of bodies blinks once rather than stacking blinks up
+  static uint32_t blinked_ms = 0;
+  static bool blinked = false;
 
-  if (!blinks_enabled) {
+  if (!blinks_enabled ||
+      (blinked && lv_tick_elaps(blinked_ms) < BLINK_PERIOD_MS)) {
     return;
   }
+  blinked = true;
+  blinked_ms = lv_tick_get();
   // TODO parse from message body
   int period = BLINK_PERIOD_MS;
   int repetitions = BLINK_TIMES;
@@ -282,15 +353,25 @@ extern "C" void app_main() {
   wifi_init(on_wifi_connected);
   gui_init();
 
-  touchpads_init(button_tapped, /*test_button_touched*/ nullptr);
+  touchpads_init(post_button_tapped, /*test_button_touched*/ nullptr);
 
   setenv("TZ", "EST5EDT,M3.2.0,M11.1.0", 1);
   tzset();
 
-  clock::get();
-  warm_leds();
-
-  webserver_init(webhook_handler);
+  gui_post(
+      [](void *) {
+        clock::get();
+        warm_leds();
+        lv_timer_create([](lv_timer_t *) { log_flip_stats(); },
+                        FLIP_STATS_PERIOD_MS, nullptr);
+      },
+      nullptr);
+
+  // Bodies can come many times a second; the GUI task only ever hears about
+  // the newest one it hasn't seen, however many came since it last looked
+  webhook_text_set_applied_callback(
+      [](const webhook_text_body &) { show_webhook(); });
+  webserver_init(webhook_text_post);
 
   struct stat st {};
   if (stat(SPIFFS_MOUNTPOINT "wifi.txt", &st) == 0) {
@@ -0,0 +1,187 @@
+//  SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//  SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+// RGB565 scaling and blending two pixels at a time. A 32-bit word holds a
+// pair of pixels, and masking a channel out of it leaves that channel of
+// both pixels in its own 16-bit lane, with room for it to be multiplied by a
+// level out of 32 without spilling into the other lane. Three multiplies
+// then do the work of six, with no unpacking to lv_color_t and back.
+//
+// Pixels stored byte swapped (LV_COLOR_16_SWAP) keep red and blue whole, just
+// in other bits, but green is split across both bytes and is gathered back
+// into one lane to be worked on, so the carries of its low bits aren't lost.
+
+constexpr uint32_t RGB565_RB_LANES = 0x001F001F;
+constexpr uint32_t RGB565_G_LANES = 0x003F003F;
+
+// Full brightness, or all of the second pixel, as a level
+constexpr uint32_t RGB565_LEVEL_MAX = 32;
+
+// Both pixels of pair at level / 32 of their brightness
+inline uint32_t rgb565_scale_pair(uint32_t pair, uint32_t level) {
+  uint32_t r = ((((pair >> 11) & RGB565_RB_LANES) * level) >> 5) &
+               RGB565_RB_LANES;
+  uint32_t g =
+      ((((pair >> 5) & RGB565_G_LANES) * level) >> 5) & RGB565_G_LANES;
+  uint32_t b = (((pair & RGB565_RB_LANES) * level) >> 5) & RGB565_RB_LANES;
+  return (r << 11) | (g << 5) | b;
+}
+
+// alpha / 32 of the way from each pixel of `from` to the one in `to`
+inline uint32_t rgb565_blend_pair(uint32_t from, uint32_t to, uint32_t alpha) {
+  uint32_t inverse = RGB565_LEVEL_MAX - alpha;
+  uint32_t r = ((((from >> 11) & RGB565_RB_LANES) * inverse +
+                 ((to >> 11) & RGB565_RB_LANES) * alpha) >>
+                5) &
+               RGB565_RB_LANES;
+  uint32_t g = ((((from >> 5) & RGB565_G_LANES) * inverse +
+                 ((to >> 5) & RGB565_G_LANES) * alpha) >>
+                5) &
+               RGB565_G_LANES;
+  uint32_t b = (((from & RGB565_RB_LANES) * inverse +
+                 (to & RGB565_RB_LANES) * alpha) >>
+                5) &
+               RGB565_RB_LANES;
+  return (r << 11) | (g << 5) | b;
+}
+
+// Byte swapped, red is bits 3-7 of each pixel, blue bits 8-12 and green the
+// top three bits of bits 0-2 and the bottom three of bits 13-15
+inline uint32_t rgb565_swapped_green(uint32_t pair) {
+  return ((pair << 3) & 0x00380038) | ((pair >> 13) & 0x00070007);
+}
+
+inline uint32_t rgb565_swapped_pack(uint32_t r, uint32_t g, uint32_t b) {
+  return (r << 3) | (b << 8) | ((g >> 3) & 0x00070007) |
+         ((g << 13) & 0xE000E000);
+}
+
+inline uint32_t rgb565_scale_pair_swapped(uint32_t pair, uint32_t level) {
+  uint32_t r =
+      ((((pair >> 3) & RGB565_RB_LANES) * level) >> 5) & RGB565_RB_LANES;
+  uint32_t g = ((rgb565_swapped_green(pair) * level) >> 5) & RGB565_G_LANES;
+  uint32_t b =
+      ((((pair >> 8) & RGB565_RB_LANES) * level) >> 5) & RGB565_RB_LANES;
+  return rgb565_swapped_pack(r, g, b);
+}
+
+inline uint32_t rgb565_blend_pair_swapped(uint32_t from, uint32_t to,
+                                          uint32_t alpha) {
+  uint32_t inverse = RGB565_LEVEL_MAX - alpha;
+  uint32_t r = ((((from >> 3) & RGB565_RB_LANES) * inverse +
+                 ((to >> 3) & RGB565_RB_LANES) * alpha) >>
+                5) &
+               RGB565_RB_LANES;
+  uint32_t g = ((rgb565_swapped_green(from) * inverse +
+                 rgb565_swapped_green(to) * alpha) >>
+                5) &
+               RGB565_G_LANES;
+  uint32_t b = ((((from >> 8) & RGB565_RB_LANES) * inverse +
+                 ((to >> 8) & RGB565_RB_LANES) * alpha) >>
+                5) &
+               RGB565_RB_LANES;
+  return rgb565_swapped_pack(r, g, b);
+}
+
+// Pixels are loaded and stored a pair at a time once dest is word aligned,
+// and sources not aligned with it are read a pixel at a time into pairs
+inline uint32_t rgb565_load_pair(const uint16_t *pixels, bool aligned) {
+  uint32_t pair;
+  if (aligned) {
+    memcpy(&pair, __builtin_assume_aligned(pixels, 4), sizeof(pair));
+  } else {
+    pair = pixels[0] | (static_cast<uint32_t>(pixels[1]) << 16);
+  }
+  return pair;
+}
+
+inline void rgb565_store_pair(uint16_t *pixels, uint32_t pair) {
+  memcpy(__builtin_assume_aligned(pixels, 4), &pair, sizeof(pair));
+}
+
+inline bool rgb565_word_aligned(const uint16_t *pixels) {
+  return (reinterpret_cast<uintptr_t>(pixels) & 3) == 0;
+}
+
+template <bool byte_swapped>
+inline uint32_t rgb565_scale(uint32_t pair, uint32_t level) {
+  return byte_swapped ? rgb565_scale_pair_swapped(pair, level)
+                      : rgb565_scale_pair(pair, level);
+}
+
+template <bool byte_swapped>
+inline uint32_t rgb565_blend(uint32_t from, uint32_t to, uint32_t alpha) {
+  return byte_swapped ? rgb565_blend_pair_swapped(from, to, alpha)
+                      : rgb565_blend_pair(from, to, alpha);
+}
+
+template <bool byte_swapped>
+inline void rgb565_scale_row(uint16_t *dest, const uint16_t *src, int count,
+                             uint32_t level) {
+  int i = 0;
+  if (!rgb565_word_aligned(dest) && count > 0) {
+    dest[0] = static_cast<uint16_t>(rgb565_scale<byte_swapped>(src[0], level));
+    i = 1;
+  }
+
+  const bool aligned = rgb565_word_aligned(src + i);
+  for (; i + 1 < count; i += 2) {
+    rgb565_store_pair(dest + i, rgb565_scale<byte_swapped>(
+                                    rgb565_load_pair(src + i, aligned), level));
+  }
+
+  if (i < count) {
+    dest[i] = static_cast<uint16_t>(rgb565_scale<byte_swapped>(src[i], level));
+  }
+}
+
+template <bool byte_swapped>
+inline void rgb565_blend_row(uint16_t *dest, const uint16_t *from,
+                             const uint16_t *to, int count, uint32_t alpha) {
+  int i = 0;
+  if (!rgb565_word_aligned(dest) && count > 0) {
+    uint32_t pixel = rgb565_blend<byte_swapped>(from[0], to[0], alpha);
+    dest[0] = static_cast<uint16_t>(pixel);
+    i = 1;
+  }
+
+  const bool from_aligned = rgb565_word_aligned(from + i);
+  const bool to_aligned = rgb565_word_aligned(to + i);
+  for (; i + 1 < count; i += 2) {
+    rgb565_store_pair(dest + i, rgb565_blend<byte_swapped>(
+                                    rgb565_load_pair(from + i, from_aligned),
+                                    rgb565_load_pair(to + i, to_aligned),
+                                    alpha));
+  }
+
+  if (i < count) {
+    uint32_t pixel = rgb565_blend<byte_swapped>(from[i], to[i], alpha);
+    dest[i] = static_cast<uint16_t>(pixel);
+  }
+}
+
+// dest[i] = src[i] at level / 32 of its brightness
+inline void rgb565_scale_row(uint16_t *dest, const uint16_t *src, int count,
+                             uint32_t level, bool byte_swapped) {
+  if (byte_swapped) {
+    rgb565_scale_row<true>(dest, src, count, level);
+  } else {
+    rgb565_scale_row<false>(dest, src, count, level);
+  }
+}
+
+// dest[i] = alpha / 32 of the way from from[i] to to[i]
+inline void rgb565_blend_row(uint16_t *dest, const uint16_t *from,
+                             const uint16_t *to, int count, uint32_t alpha,
+                             bool byte_swapped) {
+  if (byte_swapped) {
+    rgb565_blend_row<true>(dest, from, to, count, alpha);
+  } else {
+    rgb565_blend_row<false>(dest, from, to, count, alpha);
+  }
+}
@@ -0,0 +1,63 @@
+//   SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//   SPDX-License-Identifier: MIT
+
+#include "snapshot_pool.h"
+#include "spiram_allocate.h"
+
+#include <cassert>
+
+snapshot_pool::snapshot_pool(size_t slot_count, size_t slot_size,
+                             bool internal)
+    : internal(internal), slot_count(slot_count), slot_size(slot_size) {
+  assert(slot_count > 0 && slot_count <= 32);
+  free_slots = slot_count == 32 ? UINT32_MAX : (1u << slot_count) - 1;
+}
+
+snapshot_pool::~snapshot_pool() {
+  if (buffers != nullptr) {
+    spiram_free(buffers);
+  }
+}
+
+bool snapshot_pool::allocate_buffers() {
+  if (buffers == nullptr && !allocation_failed) {
+    size_t size = slot_count * slot_size;
+    buffers = static_cast<uint8_t *>(internal ? spiram_allocate_internal(size)
+                                              : spiram_allocate(size));
+    allocation_failed = buffers == nullptr;
+  }
+  return buffers != nullptr;
+}
+
+void *snapshot_pool::acquire(size_t size) {
+  assert(size <= slot_size);
+  assert(free_slots != 0); // sized for every flapper holding two at once
+
+  bool allocated = allocate_buffers();
+  assert(allocated);
+
+  size_t slot = __builtin_ctz(free_slots);
+  free_slots &= ~(1u << slot);
+  return buffers + slot * slot_size;
+}
+
+void *snapshot_pool::try_acquire(size_t size) {
+  assert(size <= slot_size);
+  if (free_slots == 0 || !allocate_buffers()) {
+    return nullptr;
+  }
+  return acquire(size);
+}
+
+void snapshot_pool::release(void *buffer) {
+  if (buffer == nullptr) {
+    return;
+  }
+
+  size_t offset = static_cast<uint8_t *>(buffer) - buffers;
+  assert(offset % slot_size == 0 && offset / slot_size < slot_count);
+
+  size_t slot = offset / slot_size;
+  assert((free_slots & (1u << slot)) == 0);
+  free_slots |= 1u << slot;
+}
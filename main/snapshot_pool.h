@@ -0,0 +1,40 @@
+//   SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//   SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Fixed set of equally sized snapshot buffers carved out of one PSRAM
+// allocation, made the first time one is needed and kept from then on, so
+// flipping never goes back to the heap and a clock that never snapshots never
+// pays for it.
+class snapshot_pool {
+public:
+  // internal takes the slots from internal RAM instead, if it can spare them,
+  // and otherwise the pool never hands any out
+  snapshot_pool(size_t slot_count, size_t slot_size, bool internal = false);
+  ~snapshot_pool();
+
+  snapshot_pool(snapshot_pool const &) = delete;
+  void operator=(const snapshot_pool &) = delete;
+
+  void *acquire(size_t size);
+  // acquire(), or nullptr if every slot is taken or there is no memory for
+  // them
+  void *try_acquire(size_t size);
+  void release(void *buffer);
+
+  size_t get_slot_size() const { return slot_size; }
+
+private:
+  bool allocate_buffers();
+
+  uint8_t *buffers{};
+  bool internal;
+  bool allocation_failed{false};
+  size_t slot_count;
+  size_t slot_size;
+  uint32_t free_slots; // bit per slot
+};
@@ -7,10 +7,29 @@
 
 #include <esp_heap_caps.h>
 
+// Internal RAM spiram_allocate_internal() leaves for WiFi, the LWIP pools and
+// the draw buffers, which need it more than anything placed there
+constexpr size_t INTERNAL_RESERVE = 64 * 1024;
+
+static size_t allocation_count = 0;
+
 void *spiram_allocate(size_t size) {
+  allocation_count++;
   return heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
 }
 
+void *spiram_allocate_internal(size_t size) {
+  constexpr uint32_t caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+  if (heap_caps_get_free_size(caps) < size + INTERNAL_RESERVE ||
+      heap_caps_get_largest_free_block(caps) < size) {
+    return nullptr;
+  }
+  allocation_count++;
+  return heap_caps_malloc(size, caps);
+}
+
 void spiram_free(void *ptr) {
   heap_caps_free(ptr);
 }
+
+size_t spiram_allocation_count() { return allocation_count; }
@@ -8,4 +8,11 @@
 #include <stddef.h>
 
 void *spiram_allocate(size_t size);
+// Internal RAM for data read often enough to be worth keeping out of PSRAM,
+// or nullptr if taking it would leave too little for everything else.
+// spiram_free() frees it too.
+void *spiram_allocate_internal(size_t size);
 void spiram_free(void *ptr);
+// Number of spiram_allocate() calls so far, to check hot paths stay off the
+// heap
+size_t spiram_allocation_count();
@@ -0,0 +1,57 @@
+//   SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//   SPDX-License-Identifier: MIT
+
+#include "sprite_atlas.h"
+#include "spiram_allocate.h"
+
+#include <cassert>
+
+sprite_atlas::sprite_atlas(size_t capacity, size_t image_size)
+    : capacity(capacity), image_size(image_size) {
+  images = static_cast<lv_img_dsc_t *>(
+      spiram_allocate(capacity * sizeof(lv_img_dsc_t)));
+  assert(images != nullptr);
+}
+
+sprite_atlas::~sprite_atlas() {
+  spiram_free(images);
+  spiram_free(buffers);
+}
+
+void sprite_atlas::clear() {
+  spiram_free(buffers);
+  buffers = nullptr;
+  count = 0;
+}
+
+size_t sprite_atlas::add(lv_obj_t *obj) {
+  assert(count < capacity);
+  assert(lv_snapshot_buf_size_needed(obj, LV_IMG_CF_TRUE_COLOR) <= image_size);
+
+  if (buffers == nullptr) { // only once the faces are actually rendered
+    buffers = static_cast<uint8_t *>(spiram_allocate(capacity * image_size));
+    assert(buffers != nullptr);
+  }
+
+  lv_obj_update_layout(obj); // labels realign lazily after a text change
+
+  lv_img_dsc_t *image = &images[count];
+  *image = {};
+  lv_res_t result =
+      lv_snapshot_take_to_buf(obj, LV_IMG_CF_TRUE_COLOR, image,
+                              buffers + count * image_size, image_size);
+  assert(result == LV_RES_OK);
+
+  return count++;
+}
+
+size_t sprite_atlas::add(const lv_img_dsc_t &image) {
+  assert(count < capacity);
+  images[count] = image;
+  return count++;
+}
+
+const lv_img_dsc_t *sprite_atlas::get(size_t index) const {
+  assert(index < count);
+  return &images[index];
+}
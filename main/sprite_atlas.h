@@ -0,0 +1,37 @@
+//   SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//   SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <lvgl.h>
+
+// Fully rendered panel faces, snapshotted once and kept in PSRAM so flipping
+// between them never has to render the screen again. Faces rendered on an
+// earlier boot can be added straight from where they already live instead.
+class sprite_atlas {
+public:
+  sprite_atlas(size_t capacity, size_t image_size);
+  ~sprite_atlas();
+
+  sprite_atlas(sprite_atlas const &) = delete;
+  void operator=(const sprite_atlas &) = delete;
+
+  // Snapshots obj as it looks right now and returns the new entry's index
+  size_t add(lv_obj_t *obj);
+  // Adds a face that outlives the atlas, without copying its pixels
+  size_t add(const lv_img_dsc_t &image);
+  // Drops every face, and the PSRAM the snapshots were taken into
+  void clear();
+  const lv_img_dsc_t *get(size_t index) const;
+
+  size_t size() const { return count; }
+
+private:
+  uint8_t *buffers{};
+  lv_img_dsc_t *images;
+  size_t capacity;
+  size_t image_size;
+  size_t count{0};
+};
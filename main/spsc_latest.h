@@ -0,0 +1,45 @@
+//   SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//   SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Hands the newest of a stream of values from exactly one producer task to
+// one consumer task. A triple buffer: the producer writes a spare slot and
+// swaps it into the middle, the consumer swaps the middle out for its own,
+// so neither waits, values never queue up and whatever the consumer takes is
+// the latest one, whole.
+template <typename T> class spsc_latest {
+public:
+  // Returns whether the consumer had taken every value before this one,
+  // rather than this replacing one it never saw
+  bool publish(const T &value) {
+    items[back] = value;
+    uint8_t previous = middle.exchange(back | FRESH, std::memory_order_acq_rel);
+    back = previous & INDEX;
+    return (previous & FRESH) == 0;
+  }
+
+  bool take(T *value) {
+    if ((middle.load(std::memory_order_relaxed) & FRESH) == 0) {
+      return false;
+    }
+
+    uint8_t previous = middle.exchange(front, std::memory_order_acq_rel);
+    front = previous & INDEX;
+    *value = items[front];
+    return true;
+  }
+
+private:
+  static constexpr uint8_t INDEX = 0x03;
+  static constexpr uint8_t FRESH = 0x04; // published and not taken yet
+
+  std::array<T, 3> items{};
+  uint8_t back{0};                // written by the producer only
+  std::atomic<uint8_t> middle{1}; // slot index, and FRESH
+  uint8_t front{2};               // written by the consumer only
+};
@@ -0,0 +1,44 @@
+//   SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//   SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Fixed size ring for exactly one producer task and one consumer task. Each
+// side only ever writes its own index, so no lock is needed; the
+// release/acquire pair makes an item visible before its slot is published.
+template <typename T, size_t N> class spsc_ring {
+  static_assert((N & (N - 1)) == 0, "capacity must be a power of two");
+
+public:
+  bool push(const T &item) {
+    uint32_t head = head_index.load(std::memory_order_relaxed);
+    if (head - tail_index.load(std::memory_order_acquire) == N) {
+      return false;
+    }
+
+    items[head % N] = item;
+    head_index.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(T *item) {
+    uint32_t tail = tail_index.load(std::memory_order_relaxed);
+    if (tail == head_index.load(std::memory_order_acquire)) {
+      return false;
+    }
+
+    *item = items[tail % N];
+    tail_index.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+private:
+  std::array<T, N> items{};
+  std::atomic<uint32_t> head_index{0}; // written by the producer only
+  std::atomic<uint32_t> tail_index{0}; // written by the consumer only
+};
@@ -0,0 +1,268 @@
+//  SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//  SPDX-License-Identifier: MIT
+
+#include "transition_kernels.h"
+#include "rgb565_swar.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+// Tallest panel the flip works out row maps for on its own stack
+constexpr int TRANSITION_MAX_HEIGHT = 256;
+
+// How bright the flap is edge on, out of 32, rising to full brightness as
+// it opens out flat
+constexpr uint32_t FLAP_SHADE_MIN = 12;
+
+// The divider drawn across the flip's hinge, one row each from the top
+constexpr uint8_t DIVIDER_GRAYS[] = {0x99, 0x33, 0x55};
+
+constexpr uint16_t rgb565(uint8_t r, uint8_t g, uint8_t b) {
+  return static_cast<uint16_t>(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+}
+
+constexpr uint16_t swap_bytes(uint16_t pixel) {
+  return static_cast<uint16_t>((pixel >> 8) | (pixel << 8));
+}
+
+static int dest_width(const transition_frame &frame) {
+  return frame.dest_area.x2 - frame.dest_area.x1 + 1;
+}
+
+static int clip_width(const transition_frame &frame) {
+  return frame.clip.x2 - frame.clip.x1 + 1;
+}
+
+// Where the clipped part of panel row y goes in the strip
+static uint16_t *dest_row(const transition_frame &frame, int y) {
+  return frame.dest + (y - frame.dest_area.y1) * dest_width(frame) +
+         (frame.clip.x1 - frame.dest_area.x1);
+}
+
+static const uint16_t *source_row(const transition_frame &frame,
+                                  const transition_image &image, int y) {
+  assert(y >= image.first_row && y < frame.height);
+  if (y >= image.hot_first && y <= image.hot_last) {
+    return image.hot_pixels + (y - image.hot_first) * frame.width +
+           frame.clip.x1;
+  }
+  if (image.bytes_read != nullptr) {
+    *image.bytes_read += clip_width(frame) * sizeof(uint16_t);
+  }
+  return image.pixels + (y - image.first_row) * frame.width + frame.clip.x1;
+}
+
+static void copy_row(const transition_frame &frame, int y,
+                     const transition_image &image, int source_y) {
+  memcpy(dest_row(frame, y), source_row(frame, image, source_y),
+         clip_width(frame) * sizeof(uint16_t));
+}
+
+// copy_row, darkened to level / 32
+static void shade_row(const transition_frame &frame, int y,
+                      const transition_image &image, int source_y,
+                      uint32_t level) {
+  if (level >= RGB565_LEVEL_MAX) {
+    copy_row(frame, y, image, source_y);
+    return;
+  }
+  rgb565_scale_row(dest_row(frame, y), source_row(frame, image, source_y),
+                   clip_width(frame), level, frame.byte_swapped);
+}
+
+static void fill_row(const transition_frame &frame, int y, uint16_t pixel) {
+  std::fill_n(dest_row(frame, y), clip_width(frame), pixel);
+}
+
+static const int16_t *flip_rows(const transition_frame &frame,
+                                const flap_perspective_key &key,
+                                int16_t *scratch) {
+  if (frame.perspective_rows != nullptr) {
+    return frame.perspective_rows(key, frame.user_data);
+  }
+  assert(key.dest_height <= TRANSITION_MAX_HEIGHT);
+  flap_perspective_rows(key, 0, key.dest_height, scratch);
+  return scratch;
+}
+
+// A flap dest_height rows tall out of full_height when lying flat
+static uint32_t flap_shade(int dest_height, int full_height) {
+  if (full_height <= 0 || dest_height >= full_height) {
+    return RGB565_LEVEL_MAX;
+  }
+  return FLAP_SHADE_MIN +
+         (RGB565_LEVEL_MAX - FLAP_SHADE_MIN) * dest_height / full_height;
+}
+
+// Where a row of a flip frame comes from
+enum class flip_source { after, before, flap, divider, gap };
+
+struct flip_row {
+  flip_source source;
+  int source_y; // the row of the image, or of the divider
+};
+
+// What is where on the panel for one flip frame
+struct flip_layout {
+  int axis;
+  int divider;
+  // the first row of the half in perspective, its row map, if any, which
+  // face it is a half of and how much it is shaded for facing away
+  int flap_y;
+  const int16_t *flap_rows;
+  bool flap_after;
+  uint32_t flap_level;
+  int16_t scratch[TRANSITION_MAX_HEIGHT];
+};
+
+static void flip_layout_init(const transition_frame &frame,
+                             flip_layout &layout) {
+  const int axis = flap_axis_y(frame.height);
+  const int divider = transition_flip_divider_y(frame.progress, frame.height);
+  layout.axis = axis;
+  layout.divider = divider;
+  layout.flap_y = 0;
+  layout.flap_rows = nullptr;
+  layout.flap_after = false;
+  layout.flap_level = RGB565_LEVEL_MAX;
+
+  if (divider < axis - 2) {
+    flap_perspective_key key{.src_y1 = 0,
+                             .src_y2 = static_cast<int16_t>(axis - 1),
+                             .dest_height =
+                                 static_cast<int16_t>(axis - 2 - divider),
+                             .invert = false};
+    layout.flap_y = divider;
+    layout.flap_rows = flip_rows(frame, key, layout.scratch);
+    layout.flap_level = flap_shade(key.dest_height, axis - 2);
+  } else if (divider > axis) {
+    flap_perspective_key key{.src_y1 = static_cast<int16_t>(axis),
+                             .src_y2 = static_cast<int16_t>(frame.height - 1),
+                             .dest_height =
+                                 static_cast<int16_t>(divider - axis + 1),
+                             .invert = false};
+    layout.flap_y = axis;
+    layout.flap_rows = flip_rows(frame, key, layout.scratch);
+    layout.flap_after = true;
+    layout.flap_level = flap_shade(key.dest_height, frame.height - axis + 1);
+  }
+}
+
+// Above the divider is the new face's top half, flat, and below the half in
+// perspective is the old face's bottom half. The half in perspective is the
+// old top half on its way down to the axis, then the new bottom half on its
+// way down past it, with a black gap at the hinge until it gets there. The
+// half in perspective is shaded darker the closer it is to edge on.
+static flip_row flip_row_at(const flip_layout &layout, int y) {
+  const int axis = layout.axis;
+  const int divider = layout.divider;
+
+  if (divider <= axis) {
+    if (y < divider) {
+      return {flip_source::after, y};
+    } else if (y <= divider + 2) {
+      return {flip_source::divider, y - divider};
+    } else if (y >= axis) {
+      return {flip_source::before, y};
+    } else if (layout.flap_rows != nullptr && y <= axis - 3) {
+      return {flip_source::flap, layout.flap_rows[y - layout.flap_y]};
+    }
+    return {flip_source::gap, 0};
+  }
+
+  if (y < axis) {
+    return {flip_source::after, y};
+  } else if (y <= divider) {
+    return {flip_source::flap, layout.flap_rows[y - layout.flap_y]};
+  } else if (y <= divider + 2) {
+    return {flip_source::divider, y - divider};
+  }
+  return {flip_source::before, y};
+}
+
+void transition_flip(const transition_frame &frame) {
+  uint16_t divider_colors[std::size(DIVIDER_GRAYS)];
+  for (size_t i = 0; i < std::size(DIVIDER_GRAYS); i++) {
+    uint16_t pixel =
+        rgb565(DIVIDER_GRAYS[i], DIVIDER_GRAYS[i], DIVIDER_GRAYS[i]);
+    divider_colors[i] = frame.byte_swapped ? swap_bytes(pixel) : pixel;
+  }
+
+  flip_layout layout;
+  flip_layout_init(frame, layout);
+  const transition_image &flap_image =
+      layout.flap_after ? frame.after : frame.before;
+
+  for (int y = frame.clip.y1; y <= frame.clip.y2; y++) {
+    flip_row row = flip_row_at(layout, y);
+    switch (row.source) {
+    case flip_source::after:
+      copy_row(frame, y, frame.after, row.source_y);
+      break;
+    case flip_source::before:
+      copy_row(frame, y, frame.before, row.source_y);
+      break;
+    case flip_source::flap:
+      shade_row(frame, y, flap_image, row.source_y, layout.flap_level);
+      break;
+    case flip_source::divider:
+      fill_row(frame, y, divider_colors[row.source_y]);
+      break;
+    case flip_source::gap:
+      fill_row(frame, y, 0);
+      break;
+    }
+  }
+}
+
+static int slide_offset(const transition_frame &frame) {
+  return frame.progress * frame.height / TRANSITION_PROGRESS_MAX;
+}
+
+void transition_slide(const transition_frame &frame) {
+  const int offset = slide_offset(frame);
+
+  for (int y = frame.clip.y1; y <= frame.clip.y2; y++) {
+    if (y < offset) {
+      copy_row(frame, y, frame.after, frame.height - offset + y);
+    } else {
+      copy_row(frame, y, frame.before, y - offset);
+    }
+  }
+}
+
+void transition_crossfade(const transition_frame &frame) {
+  const uint32_t alpha =
+      frame.progress * RGB565_LEVEL_MAX / TRANSITION_PROGRESS_MAX;
+
+  for (int y = frame.clip.y1; y <= frame.clip.y2; y++) {
+    rgb565_blend_row(dest_row(frame, y), source_row(frame, frame.before, y),
+                     source_row(frame, frame.after, y), clip_width(frame),
+                     alpha, frame.byte_swapped);
+  }
+}
+
+// Bayer matrix, so the pixels that switch each frame are spread evenly
+// instead of clumping
+constexpr uint8_t DISSOLVE_ORDER[8][8] = {
+    {0, 32, 8, 40, 2, 34, 10, 42},  {48, 16, 56, 24, 50, 18, 58, 26},
+    {12, 44, 4, 36, 14, 46, 6, 38}, {60, 28, 52, 20, 62, 30, 54, 22},
+    {3, 35, 11, 43, 1, 33, 9, 41},  {51, 19, 59, 27, 49, 17, 57, 25},
+    {15, 47, 7, 39, 13, 45, 5, 37}, {63, 31, 55, 23, 61, 29, 53, 21},
+};
+
+void transition_dissolve(const transition_frame &frame) {
+  const int threshold = frame.progress * 64 / TRANSITION_PROGRESS_MAX;
+
+  for (int y = frame.clip.y1; y <= frame.clip.y2; y++) {
+    uint16_t *dest = dest_row(frame, y);
+    const uint16_t *from = source_row(frame, frame.before, y);
+    const uint16_t *to = source_row(frame, frame.after, y);
+    const uint8_t *order = DISSOLVE_ORDER[y & 7];
+
+    for (int x = 0; x < clip_width(frame); x++) {
+      dest[x] = order[(frame.clip.x1 + x) & 7] < threshold ? to[x] : from[x];
+    }
+  }
+}
@@ -0,0 +1,77 @@
+//  SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//  SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstdint>
+
+#include "flap_kernels.h"
+
+// The ways a panel can go from one face to the next. Each kernel draws one
+// strip of one frame of its transition straight into the draw buffer, from
+// nothing but the two faces and how far along the transition is, so the
+// flapper can swap them per flip and the host benchmarks can time them
+// without LVGL.
+
+// Progress through a transition, from all before to all after
+constexpr int TRANSITION_PROGRESS_MAX = 1024;
+
+// Inclusive corners, like lv_area_t
+struct transition_area {
+  int x1;
+  int y1;
+  int x2;
+  int y2;
+};
+
+// Rows of a face, from first_row down. A whole face starts at row 0.
+struct transition_image {
+  const uint16_t *pixels;
+  int first_row;
+  // Rows hot_first to hot_last are read from a copy at hot_pixels instead,
+  // kept somewhere faster to read than pixels
+  const uint16_t *hot_pixels{};
+  int hot_first{0};
+  int hot_last{-1};
+  // Counts the bytes read from pixels, if set
+  uint32_t *bytes_read{};
+};
+
+using transition_rows_cb = const int16_t *(*)(const flap_perspective_key &key,
+                                              void *user_data);
+
+// One strip of one frame. before and after are whole panel images, and the
+// areas are in panel coordinates. Every pixel inside clip is written, nothing
+// outside it.
+struct transition_frame {
+  transition_image before;
+  transition_image after;
+  int width;
+  int height;
+  int progress;
+  transition_area clip;
+  uint16_t *dest; // the strip, covering dest_area
+  transition_area dest_area;
+  bool byte_swapped; // pixels are stored big endian (LV_COLOR_16_SWAP)
+  // Where the flip gets its perspective row maps, if not worked out on the
+  // spot
+  transition_rows_cb perspective_rows;
+  void *user_data;
+};
+
+using transition_kernel = void (*)(const transition_frame &frame);
+
+// The split-flap: the top half of the old face folds down over the bottom
+// half, and the top half of the new face is revealed behind it
+void transition_flip(const transition_frame &frame);
+// The new face pushes the old one down out of the panel
+void transition_slide(const transition_frame &frame);
+// Blends from the old face into the new one
+void transition_crossfade(const transition_frame &frame);
+// Swaps in more of the new face's pixels every frame, in an ordered dither
+void transition_dissolve(const transition_frame &frame);
+
+// The row the flip's divider is on at progress, on a panel `height` rows tall
+constexpr int transition_flip_divider_y(int progress, int height) {
+  return progress * height / TRANSITION_PROGRESS_MAX;
+}
@@ -0,0 +1,74 @@
+//   SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//   SPDX-License-Identifier: MIT
+
+#include "webhook_text.h"
+#include "clock.h"
+#include "gui.h"
+#include "spsc_latest.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+
+static spsc_latest<webhook_text_body> targets;
+static uint32_t received = 0; // receiving task only
+
+static uint32_t applied_sequence = 0;
+static webhook_text_stats stats{};
+static webhook_text_applied_callback applied_callback = nullptr;
+
+void webhook_text_post(const uint8_t *body, size_t length) {
+  if (webhook_text_receive(body, length)) {
+    gui_post([](void *) { webhook_text_apply(); }, nullptr);
+  }
+}
+
+bool webhook_text_receive(const uint8_t *body, size_t length) {
+  while (length > 0 && isspace(body[length - 1])) {
+    length--; // "echo 42 | curl -d @-" sends a newline
+  }
+
+  // the tick only reads the clock, so it can be taken on any task
+  webhook_text_body target{.sequence = ++received,
+                        .received_ms = lv_tick_get(),
+                        .show_clock = length == 0,
+                        .symbols = {}};
+  for (size_t i = 0; i < std::min(length, target.symbols.size()); i++) {
+    target.symbols[i] = clock_text_symbol(static_cast<char>(body[i]));
+  }
+  return targets.publish(target);
+}
+
+void webhook_text_apply() {
+  webhook_text_body target{};
+  if (!targets.take(&target)) {
+    return;
+  }
+
+  // this body and every one it replaced
+  uint32_t bodies = target.sequence - applied_sequence;
+  applied_sequence = target.sequence;
+  stats.received += bodies;
+  stats.coalesced += bodies - 1;
+  stats.applied++;
+  stats.max_apply_ms =
+      std::max(stats.max_apply_ms, lv_tick_elaps(target.received_ms));
+
+  if (target.show_clock) {
+    clock::get().set_mode(clock_mode::time);
+  } else {
+    clock::get().show_text(target.symbols);
+  }
+  if (applied_callback != nullptr) {
+    applied_callback(target);
+  }
+}
+
+void webhook_text_set_applied_callback(
+    webhook_text_applied_callback callback) {
+  applied_callback = callback;
+}
+
+webhook_text_stats webhook_text_get_stats() { return stats; }
+
+void webhook_text_reset_stats() { stats = {}; }
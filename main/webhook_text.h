@@ -0,0 +1,47 @@
+//   SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//   SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "clock_face.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+struct webhook_text_stats {
+  uint32_t received;     // bodies that reached the webhook
+  uint32_t coalesced;    // replaced by a newer body before being shown
+  uint32_t applied;      // bodies the panels were sent toward
+  uint32_t max_apply_ms; // longest from a body arriving to that
+};
+
+struct webhook_text_body {
+  uint32_t sequence; // how many bodies had been received, this one included
+  uint32_t received_ms;
+  bool show_clock; // an empty body
+  std::array<uint8_t, CLOCK_DIGIT_PANELS> symbols;
+};
+
+// On the GUI task, once the panels have been sent toward body
+using webhook_text_applied_callback = void (*)(const webhook_text_body &body);
+
+// A webhook body is shown on the digit panels: its first five characters,
+// from the left, with anything the font doesn't have left blank. An empty
+// body puts the clock back.
+//
+// Called for each body on whichever task receives them. Only the newest body
+// is kept, and webhook_text_apply() is posted to the GUI task for it unless
+// one is already waiting there.
+void webhook_text_post(const uint8_t *body, size_t length);
+// What webhook_text_post() is made of: keeps body, returning whether
+// webhook_text_apply() has to be posted for it
+bool webhook_text_receive(const uint8_t *body, size_t length);
+// On the GUI task, sends the panels toward the newest body
+void webhook_text_apply();
+// Set before any body is posted
+void webhook_text_set_applied_callback(webhook_text_applied_callback callback);
+
+// GUI task only
+webhook_text_stats webhook_text_get_stats();
+void webhook_text_reset_stats();
@@ -0,0 +1,111 @@
+//   SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//   SPDX-License-Identifier: MIT
+
+#include "flap_kernels.h"
+#include "panel_fixture.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+// One flip frame of the top half as draw_overlay sees it: the panel is drawn
+// in strips a third of its height tall, and the half in perspective is
+// copied row by row out of the snapshot it came from.
+
+constexpr int AXIS = HEIGHT / 2;
+
+// Row by row from the snapshot into the strip, the source row for each
+// destination row coming out of `rows`
+static void copy_rows(panel_fixture &f, int strip_y, int dest_y1, int dest_y2,
+                      const int16_t *rows) {
+  int first = std::max(dest_y1, strip_y);
+  int last = std::min(dest_y2, strip_y + STRIP_HEIGHT - 1);
+  for (int y = first; y <= last; y++) {
+    std::memcpy(&f.strip[(y - strip_y) * WIDTH],
+                &f.before[rows[y - first] * WIDTH], WIDTH * sizeof(uint16_t));
+  }
+}
+
+// The old kernel: every strip works the mapping out again for its own rows
+static void BM_PerspectivePerStrip(benchmark::State &state) {
+  panel_fixture f;
+  int divider_y = static_cast<int>(state.range(0));
+  flap_perspective_key key{.src_y1 = 0,
+                           .src_y2 = AXIS - 1,
+                           .dest_height = static_cast<int16_t>(AXIS - 2 -
+                                                               divider_y),
+                           .invert = false};
+  int dest_y1 = divider_y;
+  int dest_y2 = AXIS - 3;
+  std::array<int16_t, HEIGHT> rows{};
+
+  run_frames(state, f.strip.data(), [&] {
+    for (int strip_y = 0; strip_y < HEIGHT; strip_y += STRIP_HEIGHT) {
+      int first = std::max(dest_y1, strip_y);
+      int last = std::min(dest_y2, strip_y + STRIP_HEIGHT - 1);
+      if (first > last) {
+        continue;
+      }
+      flap_perspective_rows(key, first - dest_y1, last - first + 1,
+                            rows.data());
+      copy_rows(f, strip_y, dest_y1, dest_y2, rows.data());
+    }
+  });
+}
+
+// The table is worked out once per frame and every strip indexes into it
+static void BM_PerspectiveLut(benchmark::State &state) {
+  panel_fixture f;
+  int divider_y = static_cast<int>(state.range(0));
+  flap_perspective_key key{.src_y1 = 0,
+                           .src_y2 = AXIS - 1,
+                           .dest_height = static_cast<int16_t>(AXIS - 2 -
+                                                               divider_y),
+                           .invert = false};
+  int dest_y1 = divider_y;
+  int dest_y2 = AXIS - 3;
+  std::array<int16_t, HEIGHT> rows{};
+
+  run_frames(state, f.strip.data(), [&] {
+    flap_perspective_rows(key, 0, key.dest_height, rows.data());
+    for (int strip_y = 0; strip_y < HEIGHT; strip_y += STRIP_HEIGHT) {
+      int first = std::max(dest_y1, strip_y);
+      if (first > std::min(dest_y2, strip_y + STRIP_HEIGHT - 1)) {
+        continue;
+      }
+      copy_rows(f, strip_y, dest_y1, dest_y2, rows.data() + first - dest_y1);
+    }
+  });
+}
+
+// Strips drawn again in a frame whose geometry has not moved, as happens
+// when a neighbouring object invalidates part of the panel mid flip
+static void BM_PerspectiveLutCached(benchmark::State &state) {
+  panel_fixture f;
+  int divider_y = static_cast<int>(state.range(0));
+  flap_perspective_key key{.src_y1 = 0,
+                           .src_y2 = AXIS - 1,
+                           .dest_height = static_cast<int16_t>(AXIS - 2 -
+                                                               divider_y),
+                           .invert = false};
+  int dest_y1 = divider_y;
+  int dest_y2 = AXIS - 3;
+  std::array<int16_t, HEIGHT> rows{};
+  flap_perspective_rows(key, 0, key.dest_height, rows.data());
+
+  run_frames(state, f.strip.data(), [&] {
+    for (int strip_y = 0; strip_y < HEIGHT; strip_y += STRIP_HEIGHT) {
+      int first = std::max(dest_y1, strip_y);
+      if (first > std::min(dest_y2, strip_y + STRIP_HEIGHT - 1)) {
+        continue;
+      }
+      copy_rows(f, strip_y, dest_y1, dest_y2, rows.data() + first - dest_y1);
+    }
+  });
+}
+
+// divider_y from just started to nearly at the axis
+BENCHMARK(BM_PerspectivePerStrip)->Arg(0)->Arg(20)->Arg(40)->Arg(70);
+BENCHMARK(BM_PerspectiveLut)->Arg(0)->Arg(20)->Arg(40)->Arg(70);
+BENCHMARK(BM_PerspectiveLutCached)->Arg(0)->Arg(20)->Arg(40)->Arg(70);
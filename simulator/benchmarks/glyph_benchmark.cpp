@@ -0,0 +1,110 @@
+//   SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//   SPDX-License-Identifier: MIT
+
+#include "glyph_tile.h"
+#include "lv_color_mix.h"
+#include "panel_fixture.h"
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Redrawing a clock digit label: a glyph the size of Oswald 100's digits,
+// drawn the way lv_draw_sw_letter does it (4bpp to an opacity mask, then
+// lv_color_mix per pixel with the mask) against a blit of its glyph_tile,
+// which fills the pixels it covers fully and only mixes its edges.
+// LVGL also decompresses the glyph's bitmap on every draw, which isn't
+// modelled here, so the per pixel side is a lower bound.
+
+constexpr int GLYPH_WIDTH = 41;
+constexpr int GLYPH_HEIGHT = 82;
+constexpr int GLYPH_X = 20;
+constexpr int GLYPH_Y = 40;
+
+constexpr uint16_t TEXT_COLOR = 0xDBFF; // 0xFCF9D9, byte swapped
+constexpr uint16_t FLAP_COLOR = 0x6529; // 0x2D2D2D, byte swapped
+
+// An antialiased ring, about as much ink and edge as a 0
+static std::vector<uint8_t> ring_glyph() {
+  std::vector<uint8_t> bitmap((GLYPH_WIDTH * GLYPH_HEIGHT + 1) / 2);
+  const float cx = (GLYPH_WIDTH - 1) / 2.0f;
+  const float cy = (GLYPH_HEIGHT - 1) / 2.0f;
+  for (int y = 0; y < GLYPH_HEIGHT; y++) {
+    for (int x = 0; x < GLYPH_WIDTH; x++) {
+      float dx = (x - cx) / cx;
+      float dy = (y - cy) / cy;
+      float r = std::sqrt(dx * dx + dy * dy);
+      float coverage = std::min(std::min(1.0f - r, r - 0.55f) * 12.0f, 1.0f);
+      auto alpha = static_cast<uint8_t>(std::lround(
+          std::max(coverage, 0.0f) * 15.0f));
+      int i = y * GLYPH_WIDTH + x;
+      bitmap[i >> 1] |= alpha << ((i & 1) ? 0 : 4);
+    }
+  }
+  return bitmap;
+}
+
+static uint16_t mix(uint16_t color, uint16_t under, uint8_t opacity) {
+  return lv_color_mix({.full = color}, {.full = under}, opacity).full;
+}
+
+static void BM_GlyphLvDrawLetter(benchmark::State &state) {
+  std::vector<uint8_t> bitmap = ring_glyph();
+  std::vector<uint16_t> label(WIDTH * HEIGHT, FLAP_COLOR);
+  std::vector<uint8_t> mask(GLYPH_WIDTH * GLYPH_HEIGHT);
+
+  run_frames(state, label.data(), [&] {
+    for (int i = 0; i < GLYPH_WIDTH * GLYPH_HEIGHT; i++) {
+      mask[i] = glyph_alpha4(bitmap.data(), i) * 17; // _lv_bpp4_opa_table
+    }
+    for (int y = 0; y < GLYPH_HEIGHT; y++) {
+      uint16_t *dest = &label[(GLYPH_Y + y) * WIDTH + GLYPH_X];
+      const uint8_t *opa = &mask[y * GLYPH_WIDTH];
+      for (int x = 0; x < GLYPH_WIDTH; x++) {
+        if (opa[x] == 255) { // as lv_draw_sw_blend fills through a mask
+          dest[x] = TEXT_COLOR;
+        } else if (opa[x] != 0) {
+          dest[x] = mix(TEXT_COLOR, dest[x], opa[x]);
+        }
+      }
+    }
+  });
+  state.SetItemsProcessed(state.iterations() * GLYPH_WIDTH * GLYPH_HEIGHT);
+}
+
+BENCHMARK(BM_GlyphLvDrawLetter);
+
+static void BM_GlyphTileBlit(benchmark::State &state) {
+  std::vector<uint8_t> bitmap = ring_glyph();
+  std::vector<uint16_t> label(WIDTH * HEIGHT, FLAP_COLOR);
+  std::vector<uint8_t> memory(
+      glyph_tile_size(bitmap.data(), GLYPH_WIDTH, GLYPH_HEIGHT));
+  glyph_tile tile;
+  glyph_tile_build(tile, memory.data(), bitmap.data(), GLYPH_WIDTH,
+                   GLYPH_HEIGHT, TEXT_COLOR);
+  const glyph_area label_area{0, 0, WIDTH - 1, HEIGHT - 1};
+
+  run_frames(state, label.data(), [&] {
+    glyph_tile_blit(tile, GLYPH_X, GLYPH_Y, label_area, label.data(),
+                    label_area, mix);
+  });
+  state.SetItemsProcessed(state.iterations() * GLYPH_WIDTH * GLYPH_HEIGHT);
+}
+
+BENCHMARK(BM_GlyphTileBlit);
+
+// What a miss costs on top of drawing the glyph
+static void BM_GlyphTileBuild(benchmark::State &state) {
+  std::vector<uint8_t> bitmap = ring_glyph();
+  std::vector<uint8_t> memory(
+      glyph_tile_size(bitmap.data(), GLYPH_WIDTH, GLYPH_HEIGHT));
+
+  run_frames(state, memory.data(), [&] {
+    glyph_tile tile;
+    glyph_tile_build(tile, memory.data(), bitmap.data(), GLYPH_WIDTH,
+                     GLYPH_HEIGHT, TEXT_COLOR);
+  });
+  state.SetItemsProcessed(state.iterations() * GLYPH_WIDTH * GLYPH_HEIGHT);
+}
+
+BENCHMARK(BM_GlyphTileBuild);
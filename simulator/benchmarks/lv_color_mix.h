@@ -0,0 +1,39 @@
+//   SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//   SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstdint>
+
+// LVGL's lv_color_mix as this project's lv_conf builds it, for benchmarking
+// against without linking LVGL: LV_COLOR_16_SWAP, and a rounding offset of
+// 128 so the per channel branch rather than the 0x7E0F81F one.
+
+// lv_color16_t with LV_COLOR_16_SWAP
+union lv_color16_swapped {
+  struct {
+    uint16_t green_h : 3;
+    uint16_t red : 5;
+    uint16_t blue : 5;
+    uint16_t green_l : 3;
+  } ch;
+  uint16_t full;
+};
+
+#define LV_UDIV255(x) (((x)*0x8081U) >> 0x17)
+
+static inline lv_color16_swapped lv_color_mix(lv_color16_swapped c1,
+                                              lv_color16_swapped c2,
+                                              uint8_t mix) {
+  lv_color16_swapped ret;
+  ret.ch.red = LV_UDIV255((uint16_t)c1.ch.red * mix +
+                          c2.ch.red * (255 - mix) + 128);
+  uint16_t g1 = (c1.ch.green_h << 3) + c1.ch.green_l;
+  uint16_t g2 = (c2.ch.green_h << 3) + c2.ch.green_l;
+  uint16_t g = LV_UDIV255((uint16_t)g1 * mix + g2 * (255 - mix) + 128);
+  ret.ch.green_h = g >> 3;
+  ret.ch.green_l = g & 0x7;
+  ret.ch.blue = LV_UDIV255((uint16_t)c1.ch.blue * mix +
+                           c2.ch.blue * (255 - mix) + 128);
+  return ret;
+}
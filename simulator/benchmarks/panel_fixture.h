@@ -0,0 +1,44 @@
+//   SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//   SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "benchmark/benchmark.h"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// What every benchmark here draws into: one of the clock's 80x162 RGB565
+// panels, which LVGL redraws in strips a third of its height tall.
+
+constexpr int WIDTH = 80;
+constexpr int HEIGHT = 162;
+constexpr int STRIP_HEIGHT = HEIGHT / 3;
+
+struct panel_fixture {
+  // two whole panels of noise, so no kernel gets an easy ride off repeated
+  // pixels, and the strip being drawn
+  std::vector<uint16_t> before = std::vector<uint16_t>(WIDTH * HEIGHT);
+  std::vector<uint16_t> after = std::vector<uint16_t>(WIDTH * HEIGHT);
+  std::vector<uint16_t> strip = std::vector<uint16_t>(WIDTH * STRIP_HEIGHT);
+
+  panel_fixture() {
+    std::mt19937 random(1);
+    for (int i = 0; i < WIDTH * HEIGHT; i++) {
+      before[i] = static_cast<uint16_t>(random());
+      after[i] = static_cast<uint16_t>(random());
+    }
+  }
+};
+
+// Calls draw() once per iteration, without the compiler getting to drop the
+// pixels it leaves at dest
+template <typename Draw>
+void run_frames(benchmark::State &state, const void *dest, Draw draw) {
+  for (auto _ : state) {
+    draw();
+    benchmark::DoNotOptimize(dest);
+    benchmark::ClobberMemory();
+  }
+}
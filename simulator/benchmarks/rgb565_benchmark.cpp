@@ -0,0 +1,78 @@
+//   SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//   SPDX-License-Identifier: MIT
+
+#include "lv_color_mix.h"
+#include "panel_fixture.h"
+#include "rgb565_swar.h"
+
+#include <cstdint>
+
+// Blending and shading a strip of byte swapped pixels, two at a time with
+// rgb565_swar.h against a pixel at a time the way LVGL's lv_color_mix does it
+// with this project's lv_conf.
+
+constexpr int PIXELS = WIDTH * STRIP_HEIGHT;
+
+// The argument is how many pixels the sources are offset from the strip, so
+// 1 has them out of word alignment with it
+static void BM_Rgb565BlendLvColorMix(benchmark::State &state) {
+  panel_fixture s;
+  const int offset = static_cast<int>(state.range(0));
+  run_frames(state, s.strip.data(), [&] {
+    for (int y = 0; y < STRIP_HEIGHT; y++) {
+      for (int x = 0; x < WIDTH; x++) {
+        int i = y * WIDTH + x;
+        lv_color16_swapped from{.full = s.before[i + offset]};
+        lv_color16_swapped to{.full = s.after[i + offset]};
+        s.strip[i] = lv_color_mix(to, from, 96).full;
+      }
+    }
+  });
+  state.SetItemsProcessed(state.iterations() * PIXELS);
+}
+
+static void BM_Rgb565BlendSwar(benchmark::State &state) {
+  panel_fixture s;
+  const int offset = static_cast<int>(state.range(0));
+  run_frames(state, s.strip.data(), [&] {
+    for (int y = 0; y < STRIP_HEIGHT; y++) {
+      int i = y * WIDTH;
+      rgb565_blend_row(&s.strip[i], &s.before[i + offset], &s.after[i + offset],
+                       WIDTH, 12, true);
+    }
+  });
+  state.SetItemsProcessed(state.iterations() * PIXELS);
+}
+
+static void BM_Rgb565ShadeLvColorMix(benchmark::State &state) {
+  panel_fixture s;
+  const int offset = static_cast<int>(state.range(0));
+  const lv_color16_swapped black{.full = 0};
+  run_frames(state, s.strip.data(), [&] {
+    for (int y = 0; y < STRIP_HEIGHT; y++) {
+      for (int x = 0; x < WIDTH; x++) {
+        int i = y * WIDTH + x;
+        lv_color16_swapped from{.full = s.before[i + offset]};
+        s.strip[i] = lv_color_mix(from, black, 160).full;
+      }
+    }
+  });
+  state.SetItemsProcessed(state.iterations() * PIXELS);
+}
+
+static void BM_Rgb565ShadeSwar(benchmark::State &state) {
+  panel_fixture s;
+  const int offset = static_cast<int>(state.range(0));
+  run_frames(state, s.strip.data(), [&] {
+    for (int y = 0; y < STRIP_HEIGHT; y++) {
+      int i = y * WIDTH;
+      rgb565_scale_row(&s.strip[i], &s.before[i + offset], WIDTH, 20, true);
+    }
+  });
+  state.SetItemsProcessed(state.iterations() * PIXELS);
+}
+
+BENCHMARK(BM_Rgb565BlendLvColorMix)->Arg(0)->Arg(1);
+BENCHMARK(BM_Rgb565BlendSwar)->Arg(0)->Arg(1);
+BENCHMARK(BM_Rgb565ShadeLvColorMix)->Arg(0)->Arg(1);
+BENCHMARK(BM_Rgb565ShadeSwar)->Arg(0)->Arg(1);
@@ -0,0 +1,81 @@
+//   SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//   SPDX-License-Identifier: MIT
+
+#include "panel_fixture.h"
+#include "transition_kernels.h"
+
+#include <cstdint>
+#include <vector>
+
+// Each transition kernel drawing one strip, a third of the panel tall, at a
+// given progress. The strip is the middle third, where the flip's hinge is.
+
+// As the flapper does: a frame's row map is worked out for its first strip
+// and looked up for the rest
+struct row_table {
+  flap_perspective_key key{};
+  std::vector<int16_t> rows = std::vector<int16_t>(HEIGHT);
+};
+
+static const int16_t *cached_rows(const flap_perspective_key &key,
+                                  void *user_data) {
+  auto *table = static_cast<row_table *>(user_data);
+  if (!(key == table->key)) {
+    flap_perspective_rows(key, 0, key.dest_height, table->rows.data());
+    table->key = key;
+  }
+  return table->rows.data();
+}
+
+static void run_kernel(benchmark::State &state, transition_kernel kernel,
+                       bool cache_rows) {
+  panel_fixture f;
+  transition_area strip_area{0, STRIP_HEIGHT, WIDTH - 1, 2 * STRIP_HEIGHT - 1};
+  transition_frame frame{.before = {f.before.data(), 0},
+                         .after = {f.after.data(), 0},
+                         .width = WIDTH,
+                         .height = HEIGHT,
+                         .progress = static_cast<int>(state.range(0)),
+                         .clip = strip_area,
+                         .dest = f.strip.data(),
+                         .dest_area = strip_area,
+                         .byte_swapped = true,
+                         .perspective_rows = nullptr,
+                         .user_data = nullptr};
+
+  row_table table;
+  if (cache_rows) {
+    frame.perspective_rows = cached_rows;
+    frame.user_data = &table;
+  }
+
+  run_frames(state, f.strip.data(), [&] { kernel(frame); });
+  state.SetItemsProcessed(state.iterations() * WIDTH * STRIP_HEIGHT);
+}
+
+static void BM_TransitionFlip(benchmark::State &state) {
+  run_kernel(state, transition_flip, false);
+}
+
+static void BM_TransitionFlipCachedRows(benchmark::State &state) {
+  run_kernel(state, transition_flip, true);
+}
+
+static void BM_TransitionSlide(benchmark::State &state) {
+  run_kernel(state, transition_slide, false);
+}
+
+static void BM_TransitionCrossfade(benchmark::State &state) {
+  run_kernel(state, transition_crossfade, false);
+}
+
+static void BM_TransitionDissolve(benchmark::State &state) {
+  run_kernel(state, transition_dissolve, false);
+}
+
+// a quarter of the way, half way (the flap at the hinge) and three quarters
+BENCHMARK(BM_TransitionFlip)->Arg(256)->Arg(512)->Arg(768);
+BENCHMARK(BM_TransitionFlipCachedRows)->Arg(256)->Arg(512)->Arg(768);
+BENCHMARK(BM_TransitionSlide)->Arg(256)->Arg(512)->Arg(768);
+BENCHMARK(BM_TransitionCrossfade)->Arg(256)->Arg(512)->Arg(768);
+BENCHMARK(BM_TransitionDissolve)->Arg(256)->Arg(512)->Arg(768);
@@ -29,7 +29,7 @@
 #define LV_COLOR_DEPTH 16
 
 /*Swap the 2 bytes of RGB565 color. Useful if the display has an 8-bit interface (e.g. SPI)*/
-#define LV_COLOR_16_SWAP 0
+#define LV_COLOR_16_SWAP 1 // matches the device, the emulated panels expect big endian pixels
 
 /*Enable more complex drawing routines to manage screens transparency.
 *Can be used if the UI is above another layer, e.g. an OSD menu or video player.
@@ -48,7 +48,8 @@
 *=========================*/
 
 /*1: use custom malloc/free, 0: use the built-in `lv_mem_alloc()` and `lv_mem_free()`*/
-#define LV_MEM_CUSTOM 0
+/*On as on the device (CONFIG_LV_MEM_CUSTOM), so every allocation LVGL makes is a malloc, and counted*/
+#define LV_MEM_CUSTOM 1
 #if LV_MEM_CUSTOM == 0
    /*Size of the memory available for `lv_mem_alloc()` in bytes (>= 2kB)*/
    #define LV_MEM_SIZE (8192 * 1024U)          /*[bytes]*/
@@ -62,10 +63,10 @@
 #endif
 
 #else       /*LV_MEM_CUSTOM*/
-   #define LV_MEM_CUSTOM_INCLUDE <stdlib.h>   /*Header for the dynamic memory function*/
-   #define LV_MEM_CUSTOM_ALLOC   malloc
-   #define LV_MEM_CUSTOM_FREE    free
-   #define LV_MEM_CUSTOM_REALLOC realloc
+   #define LV_MEM_CUSTOM_INCLUDE "lvgl_counted_alloc.h"   /*Header for the dynamic memory function*/
+   #define LV_MEM_CUSTOM_ALLOC   lvgl_counted_alloc
+   #define LV_MEM_CUSTOM_FREE    lvgl_counted_free
+   #define LV_MEM_CUSTOM_REALLOC lvgl_counted_realloc
 #endif     /*LV_MEM_CUSTOM*/
 
 /*Number of the intermediate memory buffer used during rendering and other internal processing mechanisms.
@@ -0,0 +1,23 @@
+//   SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//   SPDX-License-Identifier: MIT
+//
+//
+
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// malloc, free and realloc for LVGL, as on the device, counting each time
+// LVGL allocates or grows a block
+void *lvgl_counted_alloc(size_t size);
+void lvgl_counted_free(void *ptr);
+void *lvgl_counted_realloc(void *ptr, size_t size);
+size_t lvgl_allocation_count(void);
+
+#ifdef __cplusplus
+}
+#endif
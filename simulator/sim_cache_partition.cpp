@@ -0,0 +1,46 @@
+//   SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//   SPDX-License-Identifier: MIT
+
+#include "drivers/cache_partition.h"
+
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+// The same size as in partitions.csv
+constexpr size_t SIM_CACHE_PARTITION_SIZE = 1024 * 1024;
+constexpr size_t SIM_CACHE_ERASE_SIZE = 4096;
+
+static std::vector<uint8_t> storage(SIM_CACHE_PARTITION_SIZE, 0xFF);
+
+size_t cache_partition_size() { return storage.size(); }
+
+const uint8_t *cache_partition_map(size_t size) {
+  return size <= storage.size() ? storage.data() : nullptr;
+}
+
+bool cache_partition_erase(size_t size) {
+  size_t rounded = (size + SIM_CACHE_ERASE_SIZE - 1) / SIM_CACHE_ERASE_SIZE *
+                   SIM_CACHE_ERASE_SIZE;
+  if (rounded > storage.size()) {
+    return false;
+  }
+  memset(storage.data(), 0xFF, rounded);
+  return true;
+}
+
+bool cache_partition_write(size_t offset, const void *data, size_t size) {
+  if (offset + size > storage.size()) {
+    return false;
+  }
+  // flash can only clear bits, so catch writes to a range not erased first
+  for (size_t i = 0; i < size; i++) {
+    assert(storage[offset + i] == 0xFF);
+  }
+  memcpy(storage.data() + offset, data, size);
+  return true;
+}
+
+void cache_partition_build_id(uint8_t id[CACHE_PARTITION_BUILD_ID_SIZE]) {
+  memset(id, 0, CACHE_PARTITION_BUILD_ID_SIZE);
+}
@@ -0,0 +1,141 @@
+//   SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//   SPDX-License-Identifier: MIT
+
+#include "sim_lcd_bus.h"
+#include "drivers/lcd_bus.h"
+
+#include <algorithm>
+#include <cassert>
+
+constexpr size_t VISIBLE_OFFSET_X = 24; // CONFIG_OFFSETX in lcds.cpp
+
+static st7735_emulator panels[NUM_LCDS];
+static lcd_bus_stats bus_stats{};
+static uint64_t bus_time_ns = 0;
+
+static sim_lcd_frame_stats frame_stats{};
+static uint64_t frame_bytes = 0;
+static uint32_t frame_transactions = 0;
+static uint64_t frame_bus_time_ns = 0;
+
+void lcd_bus_init() { bus_stats.bus_reconfigurations++; }
+
+void lcd_bus_hardware_reset() {
+  for (auto &panel : panels) {
+    panel.reset();
+  }
+}
+
+void lcd_bus_set_backlight([[maybe_unused]] bool on) {}
+
+void lcd_bus_queue(uint8_t cs_mask, uint8_t dc, const uint8_t *data,
+                   size_t length, lcd_blit_done_cb done_cb,
+                   void *done_user_data) {
+  assert(cs_mask != 0 && (cs_mask & ~LCD_ALL_MASK) == 0);
+
+  // split the same way the SPI driver does so transaction counts line up
+  while (length > 0) {
+    size_t this_send_length = std::min(length, LCD_SPI_MAX_TRANSFER_SIZE);
+
+    for (size_t i = 0; i < NUM_LCDS; i++) {
+      if (cs_mask & (1 << i)) {
+        panels[i].write(dc, data, this_send_length);
+      }
+    }
+
+    uint64_t time_ns = st7735_transaction_ns(this_send_length, LCD_BUS_CLOCK_HZ);
+    bus_time_ns += time_ns;
+    frame_bus_time_ns += time_ns;
+    frame_bytes += this_send_length;
+    frame_transactions++;
+
+    bus_stats.transactions++;
+    bus_stats.bytes += this_send_length;
+    if ((cs_mask & (cs_mask - 1)) != 0) {
+      bus_stats.broadcast_transactions++;
+    }
+
+    length -= this_send_length;
+    data += this_send_length;
+  }
+
+  // the transfer is already "out", so completion is immediate
+  if (done_cb != nullptr) {
+    done_cb(done_user_data);
+  }
+}
+
+void lcd_bus_wait_idle() {}
+
+void lcd_bus_delay_us(uint32_t delay_us) {
+  bus_time_ns += static_cast<uint64_t>(delay_us) * 1000;
+}
+
+void lcd_bus_collect_stats(lcd_bus_stats *stats) {
+  stats->bus_reconfigurations = bus_stats.bus_reconfigurations;
+  stats->transactions = bus_stats.transactions;
+  stats->broadcast_transactions = bus_stats.broadcast_transactions;
+  stats->bytes = bus_stats.bytes;
+  stats->bus_time_us = bus_time_ns / 1000;
+}
+
+void lcd_bus_reset_stats() {
+  bus_stats = {};
+  bus_time_ns = 0;
+}
+
+const uint16_t *sim_lcd_framebuffer(size_t index) {
+  assert(index < NUM_LCDS);
+  return panels[index].gram() + VISIBLE_OFFSET_X;
+}
+
+uint32_t sim_lcd_pixels_received(size_t index) {
+  assert(index < NUM_LCDS);
+  return panels[index].pixels_written();
+}
+
+bool sim_lcds_identical(uint8_t mask) {
+  const uint16_t *reference = nullptr;
+  for (size_t i = 0; i < NUM_LCDS; i++) {
+    if ((mask & (1 << i)) == 0) {
+      continue;
+    }
+    if (reference == nullptr) {
+      reference = sim_lcd_framebuffer(i);
+      continue;
+    }
+
+    const uint16_t *framebuffer = sim_lcd_framebuffer(i);
+    for (size_t y = 0; y < LCD_HEIGHT; y++) {
+      if (!std::equal(&reference[y * SIM_LCD_FRAMEBUFFER_STRIDE],
+                      &reference[y * SIM_LCD_FRAMEBUFFER_STRIDE + LCD_WIDTH],
+                      &framebuffer[y * SIM_LCD_FRAMEBUFFER_STRIDE])) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void sim_lcd_bus_end_frame() {
+  if (frame_transactions == 0) {
+    return;
+  }
+
+  frame_stats.frames++;
+  frame_stats.bytes += frame_bytes;
+  frame_stats.transactions += frame_transactions;
+  frame_stats.bus_time_ns += frame_bus_time_ns;
+  frame_stats.max_bytes =
+      std::max(frame_stats.max_bytes, static_cast<uint32_t>(frame_bytes));
+  frame_stats.max_bus_time_ns =
+      std::max(frame_stats.max_bus_time_ns, frame_bus_time_ns);
+
+  frame_bytes = 0;
+  frame_transactions = 0;
+  frame_bus_time_ns = 0;
+}
+
+sim_lcd_frame_stats sim_lcd_bus_get_frame_stats() { return frame_stats; }
+
+void sim_lcd_bus_reset_frame_stats() { frame_stats = {}; }
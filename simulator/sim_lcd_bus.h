@@ -0,0 +1,35 @@
+//   SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//   SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "st7735_emulator.h"
+
+// Host implementation of drivers/lcd_bus.h: every byte lcds.cpp sends is fed
+// to an emulated ST7735 per chip select, and bus time is modelled instead of
+// spent.
+
+// rows of sim_lcd_framebuffer() are this many pixels apart
+constexpr size_t SIM_LCD_FRAMEBUFFER_STRIDE = ST7735_GRAM_WIDTH;
+
+// The visible LCD_WIDTH x LCD_HEIGHT part of a panel's GRAM, native RGB565
+const uint16_t *sim_lcd_framebuffer(size_t index);
+uint32_t sim_lcd_pixels_received(size_t index);
+bool sim_lcds_identical(uint8_t mask);
+
+struct sim_lcd_frame_stats {
+  uint32_t frames; // frames that put anything on the bus
+  uint64_t bytes;
+  uint32_t transactions;
+  uint64_t bus_time_ns;
+  uint32_t max_bytes;
+  uint64_t max_bus_time_ns;
+};
+
+// Closes the bus traffic since the last call as one frame
+void sim_lcd_bus_end_frame();
+sim_lcd_frame_stats sim_lcd_bus_get_frame_stats();
+void sim_lcd_bus_reset_frame_stats();
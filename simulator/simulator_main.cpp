@@ -2,18 +2,56 @@
 //   SPDX-License-Identifier: MIT
 
 #include <SDL2/SDL.h>
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <new>
 #include <stdexcept>
-#include <unistd.h>
 
 #include "lvgl.h"
 
 #include "clock.h"
+#include "display_refresh.h"
+#include "drivers/lcd_shadow.h"
 #include "drivers/lcds.h"
+#include "flapper.h"
+#include "glyph_cache.h"
 #include "gui.h"
+#include "lvgl_counted_alloc.h"
+#include "sim_lcd_bus.h"
 #include "spiram_allocate.h"
+#include "spsc_ring.h"
+#include "webhook_text.h"
 
 constexpr auto MARGIN_SIZE = 30;
+constexpr uint32_t BUS_STATS_PERIOD_MS = 10000;
+// Longest --self-check waits for the panels to stop flipping after a minute
+constexpr uint32_t SELF_CHECK_SETTLE_MS = 30000;
+// How long --ticker-check runs the stopwatch for
+constexpr uint32_t TICKER_CHECK_MS = 10000;
+// --ticker-stress steps both rightmost tickers this often, sliding for as
+// long as the tenths do, and fails if a panel went longer than this between
+// two frames of a slide or a step waited longer than this to be admitted:
+// any later and most of the slide is gone
+constexpr uint32_t TICKER_STRESS_PERIOD_MS = 100;
+constexpr uint32_t TICKER_STRESS_SLIDE_MS = 60;
+constexpr uint32_t TICKER_STRESS_MAX_WAIT_MS = 2 * LV_DISP_DEF_REFR_PERIOD;
+constexpr uint32_t COUNTDOWN_MS = 5 * 60 * 1000;
+// --webhook-load posts a counter this often, for this long, after warming up
+// for a while, and fails if a body takes longer than this to be shown or the
+// panels longer than this to finish flipping to the last one
+constexpr uint32_t WEBHOOK_LOAD_PERIOD_MS = 20;
+constexpr uint32_t WEBHOOK_LOAD_WARM_UP_MS = 3000;
+constexpr uint32_t WEBHOOK_LOAD_MS = 10000;
+constexpr uint32_t WEBHOOK_LOAD_MAX_APPLY_MS = 100;
+// and from a body arriving to the first frame of it going out, which waits
+// for a flip still going on its panels to finish
+constexpr uint32_t WEBHOOK_LOAD_MAX_FLUSH_MS = 1000 + 100;
+constexpr uint32_t WEBHOOK_LOAD_MAX_SETTLE_MS = 3000;
 constexpr int WINDOW_WIDTH = LCD_WIDTH * 6 + MARGIN_SIZE * 5;
 constexpr int WINDOW_HEIGHT = LCD_HEIGHT;
 
@@ -25,29 +63,103 @@ constexpr auto BUFFER_ROWS =
     LCD_SPI_MAX_TRANSFER_SIZE / LCD_WIDTH / sizeof(uint16_t);
 constexpr auto PIXEL_BUFFER_SIZE_PX = LCD_WIDTH * BUFFER_ROWS;
 
-static uint16_t lcd_buffers[NUM_LCDS][PIXEL_BUFFER_SIZE_PX];
-static lv_disp_draw_buf_t draw_buffers[NUM_LCDS];
+// one pair of strips shared by every display, as on the device
+static uint16_t lcd_buffers[2][PIXEL_BUFFER_SIZE_PX];
+static lv_disp_draw_buf_t shared_draw_buffer;
 static lv_disp_drv_t display_drivers[NUM_LCDS];
 static lv_disp_t *displays[NUM_LCDS];
 
 struct driver_user_data {
   size_t display_index;
+  uint8_t cs_mask; // panels this display's flushes are sent to
+  lcd_color_mode color_mode;
 };
 static struct driver_user_data driver_user_datas[NUM_LCDS];
 
+// Flushes here are done before flush_cb returns, so the device's bus is
+// modelled on the side: strips queue up behind one another for as long as
+// the emulator says they take, and a panel's frame is in flight until its
+// last strip would have gone out. --bus-slowdown N stretches every strip to
+// provoke the contention a wave of flips causes.
+static uint64_t bus_free_at_us = 0;
+static uint64_t frame_flushed_at_us[NUM_LCDS];
+static uint32_t bus_slowdown = 1;
+
+// For --ticker-stress: when each panel's last frame of a slide went out, or
+// 0 between slides, and the longest wait for the next one
+static bool watch_slides = false;
+static uint64_t slide_frame_at_us[NUM_LCDS];
+static uint64_t max_slide_frame_gap_us[NUM_LCDS];
+
+// For --webhook-load: the last body applied, until a digit panel showing or
+// flipping to one of its symbols flushes a frame, and the longest that took
+static bool webhook_flush_pending = false;
+static webhook_text_body webhook_applied{};
+static uint32_t max_webhook_flush_ms = 0;
+
+static void webhook_frame_flushed(size_t panel, uint64_t flushed_at_us) {
+  if (!webhook_flush_pending || panel >= CLOCK_DIGIT_PANELS ||
+      clock::get().digit_shown(panel) != webhook_applied.symbols[panel]) {
+    return;
+  }
+  webhook_flush_pending = false;
+  auto flush_ms = static_cast<uint32_t>(flushed_at_us / 1000 -
+                                        webhook_applied.received_ms);
+  max_webhook_flush_ms = std::max(max_webhook_flush_ms, flush_ms);
+}
+
+static void slide_frame_flushed(size_t panel, uint64_t flushed_at_us) {
+  if (slide_frame_at_us[panel] != 0) {
+    max_slide_frame_gap_us[panel] =
+        std::max(max_slide_frame_gap_us[panel],
+                 flushed_at_us - slide_frame_at_us[panel]);
+  }
+  // the frame a slide ends on counts, the wait for the next one doesn't
+  slide_frame_at_us[panel] =
+      clock::get().ticker(panel).moving() ? flushed_at_us : 0;
+}
+
 static void flush_cb(lv_disp_drv_t *disp_drv, const lv_area_t *area,
                      lv_color_t *color_p) {
   auto *user_data = static_cast<driver_user_data *>(disp_drv->user_data);
+  int width = area->x2 - area->x1 + 1;
+  int height = area->y2 - area->y1 + 1;
+
+  uint32_t bus_time_before_us = lcds_get_bus_stats().bus_time_us;
+  lcd_shadow_blit_rect_async(user_data->cs_mask, area->x1, area->y1, width,
+                             height, (uint16_t *)color_p, nullptr, nullptr);
+  lcds_wait_idle();
 
-  SDL_Rect update_area = {
-      .x = static_cast<int>(area->x1 + user_data->display_index *
-                                           (LCD_WIDTH + MARGIN_SIZE)),
-      .y = area->y1,
-      .w = area->x2 - area->x1 + 1,
-      .h = area->y2 - area->y1 + 1};
-  SDL_UpdateTexture(texture, &update_area, color_p,
-                    (int)update_area.w * sizeof(uint16_t));
-  SDL_RenderCopy(renderer, texture, &update_area, &update_area);
+  uint64_t strip_us =
+      (lcds_get_bus_stats().bus_time_us - bus_time_before_us) * bus_slowdown;
+  uint64_t now_us = lv_tick_get() * 1000ULL;
+  bus_free_at_us = std::max(bus_free_at_us, now_us) + strip_us;
+  if (lv_disp_flush_is_last(disp_drv)) {
+    frame_flushed_at_us[user_data->display_index] = bus_free_at_us;
+    if (watch_slides) {
+      slide_frame_flushed(user_data->display_index, bus_free_at_us);
+    }
+    webhook_frame_flushed(user_data->display_index, bus_free_at_us);
+  }
+
+  // show what actually arrived on each panel rather than the draw buffer
+  for (size_t i = 0; i < NUM_LCDS; i++) {
+    if ((user_data->cs_mask & (1 << i)) == 0) {
+      continue;
+    }
+
+    const uint16_t *framebuffer = sim_lcd_framebuffer(i);
+    SDL_Rect update_area = {
+        .x = static_cast<int>(area->x1 + i * (LCD_WIDTH + MARGIN_SIZE)),
+        .y = area->y1,
+        .w = width,
+        .h = height};
+    SDL_UpdateTexture(texture, &update_area,
+                      &framebuffer[area->y1 * SIM_LCD_FRAMEBUFFER_STRIDE +
+                                   area->x1],
+                      SIM_LCD_FRAMEBUFFER_STRIDE * sizeof(uint16_t));
+    SDL_RenderCopy(renderer, texture, &update_area, &update_area);
+  }
   SDL_RenderPresent(renderer);
 
   lv_disp_flush_ready(disp_drv);
@@ -65,25 +177,121 @@ static void sdl_init() {
                         SDL_TEXTUREACCESS_STATIC, WINDOW_WIDTH, WINDOW_HEIGHT);
   SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
 
+  lv_disp_draw_buf_init(&shared_draw_buffer, lcd_buffers[0], lcd_buffers[1],
+                        PIXEL_BUFFER_SIZE_PX);
   for (size_t i = 0; i < NUM_LCDS; i++) {
-    lv_disp_draw_buf_init(&draw_buffers[i], lcd_buffers[i], nullptr,
-                          PIXEL_BUFFER_SIZE_PX);
     lv_disp_drv_t *driver = &display_drivers[i];
     lv_disp_drv_init(driver);
-    driver->draw_buf = &draw_buffers[i];
+    driver->draw_buf = &shared_draw_buffer;
     driver->hor_res = LCD_WIDTH;
     driver->ver_res = LCD_HEIGHT;
     driver->flush_cb = flush_cb;
 
     struct driver_user_data *user_data = &driver_user_datas[i];
     user_data->display_index = i;
+    user_data->cs_mask = 1 << i;
+    user_data->color_mode = LCD_COLOR_RGB565;
 
     driver->user_data = user_data;
 
+    glyph_cache_install(driver);
     displays[i] = lv_disp_drv_register(driver);
+    display_refresh_install(displays[i]);
   }
 }
 
+static uint32_t wakeups = 0;
+
+static void print_bus_stats() {
+  printf("gui: %.2f wakeups/s, %zu PSRAM allocations since boot\n",
+         wakeups * 1000.0f / static_cast<float>(BUS_STATS_PERIOD_MS),
+         spiram_allocation_count());
+  wakeups = 0;
+
+  lcd_bus_stats stats = lcds_get_bus_stats();
+  // the previous driver removed and re-added the SPI device on every select
+  printf("lcd bus: %u selects, %u panel switches, %u reconfigurations "
+         "(was %u)\n",
+         stats.selects, stats.panel_switches, stats.bus_reconfigurations,
+         stats.selects * 2);
+  printf("lcd bus: %u bytes in %u transactions, %u window commands skipped, "
+         "%u ms modelled bus time\n",
+         stats.bytes, stats.transactions, stats.window_commands_skipped,
+         stats.bus_time_us / 1000);
+
+  sim_lcd_frame_stats frames = sim_lcd_bus_get_frame_stats();
+  if (frames.frames > 0) {
+    printf("lcd bus: %u frames, per frame %llu bytes / %u transactions / "
+           "%llu us (max %u bytes, %llu us)\n",
+           frames.frames,
+           static_cast<unsigned long long>(frames.bytes / frames.frames),
+           frames.transactions / frames.frames,
+           static_cast<unsigned long long>(frames.bus_time_ns / frames.frames /
+                                           1000),
+           frames.max_bytes,
+           static_cast<unsigned long long>(frames.max_bus_time_ns / 1000));
+  }
+
+  for (size_t i = 0; i < NUM_LCDS; i++) {
+    const flapper_frame_stats &flips = clock::get().frame_stats(i);
+    printf("panel %zu: %u flip frames, %u dropped, %.1f fps and %u "
+           "external bytes a frame last flip (%s hot rows)\n",
+           i, flips.frames, flips.dropped_frames, flips.fps,
+           flips.external_bytes_per_frame,
+           flips.hot_rows_internal ? "internal" : "no");
+  }
+
+  flip_scheduler &scheduler = clock::get().scheduler();
+  const flip_scheduler_stats &steps = scheduler.stats();
+  printf("flip scheduler: %u steps admitted, %u waiting (at most %u), %u ms "
+         "mean and %u ms max admission latency\n",
+         steps.admitted, steps.queue_depth, steps.max_queue_depth,
+         steps.admitted > 0 ? steps.total_latency_ms / steps.admitted : 0,
+         steps.max_latency_ms);
+  scheduler.reset_stats();
+
+  printf("clock: last minute's first flap moved %u ms after it turned over\n",
+         clock::get().boundary_latency_ms());
+
+  for (size_t i = 0; i < NUM_LCDS; i++) {
+    const digit_ticker_stats &ticks = clock::get().ticker_stats(i);
+    if (ticks.steps == 0) {
+      continue;
+    }
+    printf("panel %zu ticker: %u steps (%u late), %u frames, %u ms max step "
+           "and %u ms max between frames\n",
+           i, ticks.steps, ticks.late_steps, ticks.frames, ticks.max_step_ms,
+           ticks.max_frame_ms);
+  }
+  clock::get().reset_ticker_stats();
+
+  lcd_shadow_stats shadow = lcd_shadow_get_stats();
+  if (lcd_shadow_enabled() && frames.frames > 0) {
+    printf("lcd shadow: %u of %u bytes saved, %u bytes saved and %u PSRAM "
+           "bytes touched per frame\n",
+           shadow.bytes_offered - shadow.bytes_sent, shadow.bytes_offered,
+           (shadow.bytes_offered - shadow.bytes_sent) / frames.frames,
+           shadow.psram_bytes / frames.frames);
+  }
+
+  glyph_cache_stats glyphs = glyph_cache_get_stats();
+  printf("glyph cache: %u hits, %u misses\n", glyphs.hits, glyphs.misses);
+
+  webhook_text_stats webhooks = webhook_text_get_stats();
+  if (webhooks.received > 0) {
+    printf("webhook: %u bodies, %u coalesced, %u shown, %u ms max to show "
+           "one\n",
+           webhooks.received, webhooks.coalesced, webhooks.applied,
+           webhooks.max_apply_ms);
+  }
+
+  lcds_reset_bus_stats();
+  lcd_shadow_reset_stats();
+  sim_lcd_bus_reset_frame_stats();
+  glyph_cache_reset_stats();
+  webhook_text_reset_stats();
+}
+
 void cleanup() {
   SDL_DestroyTexture(texture);
   SDL_DestroyRenderer(renderer);
@@ -98,19 +306,548 @@ lv_disp_t *gui_get_display(size_t index) {
   return displays[index];
 }
 
-int main([[maybe_unused]] int argc, [[maybe_unused]] char **argv) {
+void gui_broadcast_refresh(size_t leader, uint8_t mask) {
+  assert(leader < NUM_LCDS);
+  struct driver_user_data *user_data = &driver_user_datas[leader];
+  mask |= 1 << leader;
+
+  uint32_t received_before[NUM_LCDS];
+  for (size_t i = 0; i < NUM_LCDS; i++) {
+    received_before[i] = sim_lcd_pixels_received(i);
+  }
+
+  user_data->cs_mask = mask;
+  lv_refr_now(displays[leader]);
+  user_data->cs_mask = 1 << leader;
+
+  for (size_t i = 0; i < NUM_LCDS; i++) {
+    if (i != leader && (mask & (1 << i))) {
+      _lv_inv_area(displays[i], nullptr);
+    }
+  }
+
+  // every selected panel must have received the whole broadcast
+  uint32_t leader_received =
+      sim_lcd_pixels_received(leader) - received_before[leader];
+  for (size_t i = 0; i < NUM_LCDS; i++) {
+    if (mask & (1 << i)) {
+      assert(sim_lcd_pixels_received(i) - received_before[i] ==
+             leader_received);
+    }
+  }
+  printf("broadcast of %u pixels to mask 0x%02x: panels %s\n",
+         leader_received, mask,
+         sim_lcds_identical(mask) ? "identical" : "DIFFER");
+}
+
+void gui_set_color_mode(lv_disp_t *display, lcd_color_mode mode) {
+  auto *user_data = static_cast<driver_user_data *>(display->driver->user_data);
+  if (user_data->color_mode == mode) {
+    return;
+  }
+
+  user_data->color_mode = mode;
+  lcd_set_color_mode(user_data->cs_mask, mode);
+  if (mode == LCD_COLOR_RGB565) {
+    lcd_shadow_invalidate(user_data->cs_mask);
+    lv_obj_invalidate(lv_disp_get_scr_act(display));
+  }
+}
+
+bool gui_frame_in_flight(lv_disp_t *display) {
+  auto *user_data = static_cast<driver_user_data *>(display->driver->user_data);
+  return lv_tick_get() * 1000ULL <
+         frame_flushed_at_us[user_data->display_index];
+}
+
+struct gui_work {
+  gui_work_cb callback;
+  void *user_data;
+};
+
+// Work posted from --webhook-load's thread, the only other one, waits here
+// for the main loop like it would for the device's GUI task
+static SDL_threadID gui_thread;
+static spsc_ring<gui_work, 16> posted_work;
+static std::atomic<uint32_t> work_posted{0};
+static std::atomic<uint32_t> work_run{0};
+static uint32_t max_work_waiting = 0; // posting thread only
+
+void gui_post(gui_work_cb callback, void *user_data) {
+  if (SDL_ThreadID() == gui_thread) {
+    callback(user_data);
+    return;
+  }
+
+  while (!posted_work.push({.callback = callback, .user_data = user_data})) {
+    SDL_Delay(1);
+  }
+  uint32_t waiting = ++work_posted - work_run.load();
+  max_work_waiting = std::max(max_work_waiting, waiting);
+}
+
+static void run_posted_work() {
+  gui_work work{};
+  while (posted_work.pop(&work)) {
+    work_run++; // before it runs, so work it lets be posted isn't counted
+    work.callback(work.user_data);
+  }
+}
+
+// Counted by the operator new replacement below
+static size_t heap_allocations = 0;
+
+static void run_until_settled() {
+  uint32_t start_ms = lv_tick_get();
+  do {
+    run_posted_work();
+    uint32_t sleep_ms = display_refresh_timer_handler();
+    sim_lcd_bus_end_frame();
+    SDL_PumpEvents();
+    SDL_Delay(std::min<uint32_t>(sleep_ms, 5));
+  } while (clock::get().flipping() &&
+           lv_tick_elaps(start_ms) < SELF_CHECK_SETTLE_MS);
+}
+
+// Shows every minute from 12:50 to 12:59, so each digit has been drawn and
+// everything allocated once, then checks that rolling over to 1:00, with the
+// most flips any minute has, allocates nothing at all, LVGL included
+static int self_check() {
+  struct tm time {};
+  time.tm_hour = 12;
+  for (time.tm_min = 50; time.tm_min < 60; time.tm_min++) {
+    clock::get().update(time);
+    run_until_settled();
+  }
+
+  size_t heap_before = heap_allocations;
+  size_t spiram_before = spiram_allocation_count();
+  size_t lvgl_before = lvgl_allocation_count();
+  time.tm_hour = 13;
+  time.tm_min = 0;
+  clock::get().update(time);
+  run_until_settled();
+  bool settled = !clock::get().flipping();
+  size_t heap = heap_allocations - heap_before;
+  size_t spiram = spiram_allocation_count() - spiram_before;
+  size_t lvgl = lvgl_allocation_count() - lvgl_before;
+
+  printf("self check: rolling over to 1:00 made %zu heap, %zu PSRAM and %zu "
+         "LVGL allocations%s\n",
+         heap, spiram, lvgl, settled ? "" : ", and never settled");
+  return heap == 0 && spiram == 0 && lvgl == 0 && settled ? EXIT_SUCCESS
+                                                          : EXIT_FAILURE;
+}
+
+// Runs the stopwatch for a while and checks its two rightmost panels, the
+// tenths changing ten times a second and the seconds once, never fell behind
+static int ticker_check() {
+  clock::get().set_mode(clock_mode::stopwatch);
+  clock::get().reset_ticker_stats();
+  clock::get().scheduler().reset_stats();
+
+  uint32_t start_ms = lv_tick_get();
+  while (lv_tick_elaps(start_ms) < TICKER_CHECK_MS) {
+    uint32_t sleep_ms = display_refresh_timer_handler();
+    sim_lcd_bus_end_frame();
+    SDL_PumpEvents();
+    SDL_Delay(std::min<uint32_t>(sleep_ms, 5));
+  }
+
+  const uint32_t step_periods_ms[] = {1000, 100};
+  bool kept_up = true;
+  for (size_t i = 0; i < 2; i++) {
+    size_t panel = NUM_LCDS - 2 + i;
+    const digit_ticker_stats &ticks = clock::get().ticker_stats(panel);
+    uint32_t expected = TICKER_CHECK_MS / step_periods_ms[i];
+    bool ok = ticks.late_steps == 0 &&
+              ticks.max_step_ms < step_periods_ms[i] &&
+              ticks.steps + 1 >= expected;
+    printf("ticker check: panel %zu made %u of %u steps, %u late, %u ms max "
+           "step, %u ms max between frames%s\n",
+           panel, ticks.steps, expected, ticks.late_steps, ticks.max_step_ms,
+           ticks.max_frame_ms, ok ? "" : " - FELL BEHIND");
+    kept_up = kept_up && ok;
+  }
+  printf("ticker check: %u ms max admission latency\n",
+         clock::get().scheduler().stats().max_latency_ms);
+  return kept_up ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Steps both rightmost tickers ten times a second, which no mode does, and
+// checks on the bus side that neither fell behind: every step admitted
+// promptly and every slide's frames flushed close together, and that once
+// every digit has been drawn stepping allocates nothing, LVGL included.
+// Reports the bus rate the two of them actually came to.
+static int ticker_stress() {
+  // text mode leaves the tickers alone, to be driven from here
+  clock::get().set_mode(clock_mode::text);
+  const size_t panels[] = {NUM_LCDS - 2, NUM_LCDS - 1};
+  for (size_t panel : panels) {
+    clock::get().ticker(panel).show(true);
+  }
+  clock::get().reset_ticker_stats();
+  clock::get().scheduler().reset_stats();
+  lcds_reset_bus_stats();
+  watch_slides = true;
+
+  static uint32_t step = 0;
+  lv_timer_t *stepper = lv_timer_create(
+      [](lv_timer_t *) {
+        step++;
+        clock::get().ticker(NUM_LCDS - 2).set('0' + step / 10 % 10,
+                                               TICKER_STRESS_SLIDE_MS);
+        clock::get().ticker(NUM_LCDS - 1).set('0' + step % 10,
+                                               TICKER_STRESS_SLIDE_MS);
+      },
+      TICKER_STRESS_PERIOD_MS, nullptr);
+
+  // counted from when the rightmost panel has shown every digit, and so
+  // every glyph tile has been made
+  bool counting = false;
+  size_t heap_before = 0, spiram_before = 0, lvgl_before = 0;
+  uint32_t start_ms = lv_tick_get();
+  while (lv_tick_elaps(start_ms) < TICKER_CHECK_MS) {
+    if (!counting && step >= 10) {
+      counting = true;
+      heap_before = heap_allocations;
+      spiram_before = spiram_allocation_count();
+      lvgl_before = lvgl_allocation_count();
+    }
+    uint32_t sleep_ms = display_refresh_timer_handler();
+    sim_lcd_bus_end_frame();
+    SDL_PumpEvents();
+    SDL_Delay(std::min<uint32_t>(sleep_ms, 5));
+  }
+  size_t heap = heap_allocations - heap_before;
+  size_t spiram = spiram_allocation_count() - spiram_before;
+  size_t lvgl = lvgl_allocation_count() - lvgl_before;
+  lv_timer_del(stepper);
+  watch_slides = false;
+  uint32_t elapsed_ms = lv_tick_elaps(start_ms);
+
+  bool kept_up = true;
+  for (size_t panel : panels) {
+    const digit_ticker_stats &ticks = clock::get().ticker_stats(panel);
+    auto max_gap_ms =
+        static_cast<uint32_t>(max_slide_frame_gap_us[panel] / 1000);
+    uint32_t expected = TICKER_CHECK_MS / TICKER_STRESS_PERIOD_MS;
+    bool ok = ticks.late_steps == 0 && ticks.steps + 1 >= expected &&
+              max_gap_ms <= TICKER_STRESS_MAX_WAIT_MS;
+    printf("ticker stress: panel %zu made %u of %u steps, %u late, %u ms max "
+           "between flushed frames of a slide%s\n",
+           panel, ticks.steps, expected, ticks.late_steps, max_gap_ms,
+           ok ? "" : " - FELL BEHIND");
+    kept_up = kept_up && ok;
+  }
+
+  uint32_t max_latency_ms = clock::get().scheduler().stats().max_latency_ms;
+  bool admitted = max_latency_ms <= TICKER_STRESS_MAX_WAIT_MS;
+  printf("ticker stress: %u ms max admission latency%s, %u KB/s on the bus\n",
+         max_latency_ms, admitted ? "" : " - TOO LATE",
+         lcds_get_bus_stats().bytes / elapsed_ms * 1000 / 1024);
+  bool allocated = !counting || heap > 0 || spiram > 0 || lvgl > 0;
+  printf("ticker stress: stepping made %zu heap, %zu PSRAM and %zu LVGL "
+         "allocations%s\n",
+         heap, spiram, lvgl, counting ? "" : ", never got past warming up");
+  return kept_up && admitted && !allocated ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Renders each digit panel showing each symbol it can, letters included, the
+// way a flip snapshots its faces and the way lv_snapshot does, and checks
+// they came out the same
+static int snapshot_check() {
+  static lv_color_t rendered[LCD_WIDTH * LCD_HEIGHT];
+  static lv_color_t snapshot[LCD_WIDTH * LCD_HEIGHT];
+  constexpr size_t symbols = CLOCK_LETTER_A + CLOCK_LETTER_SYMBOLS.size();
+
+  size_t different = 0;
+  for (size_t i = 0; i < CLOCK_DIGIT_PANELS; i++) {
+    lv_obj_t *panel = lv_obj_get_child(lv_disp_get_scr_act(displays[i]), 0);
+    lv_obj_t *label = lv_obj_get_child(panel, 0); // as clock() creates them
+    for (uint8_t symbol = 0; symbol < symbols; symbol++) {
+      lv_label_set_text_static(
+          label, symbol < CLOCK_LETTER_A
+                     ? CLOCK_DIGIT_SYMBOLS[symbol]
+                     : CLOCK_LETTER_SYMBOLS[symbol - CLOCK_LETTER_A]);
+      lv_obj_update_layout(panel);
+
+      lv_img_dsc_t rendered_image, snapshot_image;
+      flapper_snapshot(panel, &rendered_image, rendered);
+      lv_res_t result =
+          lv_snapshot_take_to_buf(panel, LV_IMG_CF_TRUE_COLOR, &snapshot_image,
+                                  snapshot, sizeof(snapshot));
+      if (result != LV_RES_OK ||
+          rendered_image.data_size != snapshot_image.data_size ||
+          memcmp(rendered, snapshot, rendered_image.data_size) != 0) {
+        printf("snapshot check: panel %zu differs showing symbol %u\n", i,
+               symbol);
+        different++;
+      }
+    }
+    lv_label_set_text_static(label, "");
+  }
+
+  printf("snapshot check: %zu of %zu faces differ\n", different,
+         CLOCK_DIGIT_PANELS * symbols);
+  return different == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Renders every panel showing each symbol it can over split_flap.png from
+// glyph tiles and again with LVGL drawing every glyph, and checks the two
+// came out the same, antialiased edges over the flap's texture included
+static int glyph_check() {
+  static lv_color_t tiled[LCD_WIDTH * LCD_HEIGHT];
+  static lv_color_t drawn[LCD_WIDTH * LCD_HEIGHT];
+
+  size_t faces = 0;
+  size_t different = 0;
+  auto compare = [&](size_t i, lv_obj_t *panel, const char *text) {
+    lv_img_dsc_t tiled_image, drawn_image;
+    glyph_cache_set_enabled(true);
+    flapper_snapshot(panel, &tiled_image, tiled);
+    glyph_cache_set_enabled(false);
+    flapper_snapshot(panel, &drawn_image, drawn);
+    glyph_cache_set_enabled(true);
+    faces++;
+    if (memcmp(tiled, drawn, tiled_image.data_size) != 0) {
+      printf("glyph check: panel %zu differs showing \"%s\"\n", i, text);
+      different++;
+    }
+  };
+
+  for (size_t i = 0; i < NUM_LCDS; i++) {
+    lv_obj_t *panel = lv_obj_get_child(lv_disp_get_scr_act(displays[i]), 0);
+    lv_obj_t *label = lv_obj_get_child(panel, 0); // as clock() creates them
+    if (i < CLOCK_DIGIT_PANELS) {
+      for (const char *text : CLOCK_DIGIT_SYMBOLS) {
+        lv_label_set_text_static(label, text);
+        compare(i, panel, text);
+      }
+      for (const char *text : CLOCK_LETTER_SYMBOLS) {
+        lv_label_set_text_static(label, text);
+        compare(i, panel, text);
+      }
+    } else {
+      lv_obj_t *bottom = lv_obj_get_child(panel, 1);
+      lv_label_set_text_static(bottom, "M");
+      for (const char *text : CLOCK_AMPM_SYMBOLS) {
+        lv_label_set_text_static(label, text);
+        compare(i, panel, text);
+      }
+      lv_label_set_text_static(bottom, "");
+    }
+    lv_label_set_text_static(label, "");
+  }
+
+  printf("glyph check: %zu of %zu faces differ\n", different, faces);
+  return different == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Posts a counter to the webhook, as a CI status or a stock ticker might, the
+// way the device's webserver does from its own task
+static std::atomic<bool> webhook_load_running{false};
+static std::atomic<uint32_t> webhook_load_count{0};
+
+static int post_webhooks(void *) {
+  while (webhook_load_running.load()) {
+    char body[8];
+    int length = snprintf(body, sizeof(body), "%05u",
+                          webhook_load_count.load() % 100000);
+    webhook_text_post(reinterpret_cast<uint8_t *>(body), length);
+    webhook_load_count++;
+    SDL_Delay(WEBHOOK_LOAD_PERIOD_MS);
+  }
+  return 0;
+}
+
+static void run_webhook_load(uint32_t duration_ms) {
+  webhook_load_running = true;
+  SDL_Thread *thread = SDL_CreateThread(post_webhooks, "webhooks", nullptr);
+  assert(thread != nullptr);
+
+  uint32_t start_ms = lv_tick_get();
+  while (lv_tick_elaps(start_ms) < duration_ms) {
+    run_posted_work();
+    uint32_t sleep_ms = display_refresh_timer_handler();
+    sim_lcd_bus_end_frame();
+    SDL_PumpEvents();
+    SDL_Delay(std::min<uint32_t>(sleep_ms, 5));
+  }
+
+  webhook_load_running = false;
+  SDL_WaitThread(thread, nullptr);
+}
+
+// Posts to the webhook at 50 Hz, as the device's webserver does, and checks
+// every body was applied, or replaced by a newer one, within a frame or two
+// and went out to the panels soon after, the panels ended up on the last one
+// soon after the posts stopped, no more than one piece of work was ever left
+// waiting for the GUI, and once warmed up nothing was allocated
+static int webhook_load() {
+  webhook_text_set_applied_callback([](const webhook_text_body &body) {
+    webhook_applied = body;
+    webhook_flush_pending = !body.show_clock;
+  });
+  run_webhook_load(WEBHOOK_LOAD_WARM_UP_MS);
+  run_until_settled();
+  webhook_text_reset_stats();
+  max_webhook_flush_ms = 0;
+
+  size_t heap_before = heap_allocations;
+  size_t spiram_before = spiram_allocation_count();
+  size_t lvgl_before = lvgl_allocation_count();
+
+  run_webhook_load(WEBHOOK_LOAD_MS);
+  uint32_t stopped_ms = lv_tick_get();
+  run_until_settled();
+  uint32_t settle_ms = lv_tick_elaps(stopped_ms);
+  bool settled = !clock::get().flipping();
+
+  size_t heap = heap_allocations - heap_before;
+  size_t spiram = spiram_allocation_count() - spiram_before;
+  size_t lvgl = lvgl_allocation_count() - lvgl_before;
+
+  char last[8];
+  snprintf(last, sizeof(last), "%05u",
+           (webhook_load_count.load() - 1) % 100000);
+  bool shown = true;
+  for (size_t i = 0; i < CLOCK_DIGIT_PANELS; i++) {
+    shown = shown && clock::get().digit_shown(i) == clock_text_symbol(last[i]);
+  }
+
+  webhook_text_stats webhooks = webhook_text_get_stats();
+  printf("webhook load: %u bodies, %u coalesced, %u shown, %u ms max to show "
+         "one and %u ms to flush its first frame, %u pieces of work waiting "
+         "at most\n",
+         webhooks.received, webhooks.coalesced, webhooks.applied,
+         webhooks.max_apply_ms, max_webhook_flush_ms, max_work_waiting);
+  printf("webhook load: %s on the panels %u ms after the last post%s, %zu "
+         "heap, %zu PSRAM and %zu LVGL allocations\n",
+         last, settle_ms, shown ? "" : " - NOT SHOWN", heap, spiram, lvgl);
+
+  bool ok = webhooks.max_apply_ms <= WEBHOOK_LOAD_MAX_APPLY_MS &&
+            max_webhook_flush_ms <= WEBHOOK_LOAD_MAX_FLUSH_MS && shown &&
+            settled && settle_ms <= WEBHOOK_LOAD_MAX_SETTLE_MS &&
+            max_work_waiting <= 1 && heap == 0 && spiram == 0 && lvgl == 0;
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static clock_mode parse_mode(const char *name) {
+  if (strcmp(name, "seconds") == 0) {
+    return clock_mode::seconds;
+  } else if (strcmp(name, "stopwatch") == 0) {
+    return clock_mode::stopwatch;
+  } else if (strcmp(name, "countdown") == 0) {
+    return clock_mode::countdown;
+  }
+  return clock_mode::time;
+}
+
+static transition_kernel parse_transition(const char *name) {
+  if (strcmp(name, "slide") == 0) {
+    return transition_slide;
+  } else if (strcmp(name, "crossfade") == 0) {
+    return transition_crossfade;
+  } else if (strcmp(name, "dissolve") == 0) {
+    return transition_dissolve;
+  }
+  return transition_flip;
+}
+
+int main(int argc, char **argv) {
+  transition_kernel transition = transition_flip;
+  clock_mode mode = clock_mode::time;
+  bool run_self_check = false;
+  bool run_ticker_check = false;
+  bool run_ticker_stress = false;
+  bool run_webhook_load_test = false;
+  bool run_snapshot_check = false;
+  bool run_glyph_check = false;
+
+  gui_thread = SDL_ThreadID();
   lv_init();
 
   sdl_init();
+  lcds_init();
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--shadow") == 0) {
+      lcd_shadow_init();
+    } else if (strcmp(argv[i], "--bus-slowdown") == 0 && i + 1 < argc) {
+      bus_slowdown = std::max(atoi(argv[++i]), 1);
+    } else if (strcmp(argv[i], "--transition") == 0 && i + 1 < argc) {
+      transition = parse_transition(argv[++i]);
+    } else if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc) {
+      mode = parse_mode(argv[++i]);
+    } else if (strcmp(argv[i], "--self-check") == 0) {
+      run_self_check = true;
+    } else if (strcmp(argv[i], "--ticker-check") == 0) {
+      run_ticker_check = true;
+    } else if (strcmp(argv[i], "--ticker-stress") == 0) {
+      run_ticker_stress = true;
+    } else if (strcmp(argv[i], "--webhook-load") == 0) {
+      run_webhook_load_test = true;
+    } else if (strcmp(argv[i], "--snapshot-check") == 0) {
+      run_snapshot_check = true;
+    } else if (strcmp(argv[i], "--glyph-check") == 0) {
+      run_glyph_check = true;
+    }
+  }
 
+  clock::get().set_transition(transition);
+  if (run_self_check) {
+    int result = self_check();
+    cleanup();
+    return result;
+  }
+  if (run_ticker_check) {
+    int result = ticker_check();
+    cleanup();
+    return result;
+  }
+  if (run_ticker_stress) {
+    int result = ticker_stress();
+    cleanup();
+    return result;
+  }
+  if (run_webhook_load_test) {
+    int result = webhook_load();
+    cleanup();
+    return result;
+  }
+  if (run_snapshot_check) {
+    int result = snapshot_check();
+    cleanup();
+    return result;
+  }
+  if (run_glyph_check) {
+    int result = glyph_check();
+    cleanup();
+    return result;
+  }
   clock::get().update();
+  if (mode != clock_mode::time) {
+    clock::get().set_mode(mode, COUNTDOWN_MS);
+  }
+
+  lv_timer_create([](lv_timer_t *) { print_bus_stats(); }, BUS_STATS_PERIOD_MS,
+                  nullptr);
 
+  // sleep until LVGL's next timer is due or SDL has something, like the
+  // device's GUI task does
   while (true) {
-    lv_timer_handler();
-    usleep(5 * 1000);
+    run_posted_work();
+    uint32_t sleep_ms = display_refresh_timer_handler();
+    sim_lcd_bus_end_frame();
 
     SDL_Event event;
-    while (SDL_PollEvent(&event)) {
+    int has_event = sleep_ms == LV_NO_TIMER_READY
+                        ? SDL_WaitEvent(&event)
+                        : SDL_WaitEventTimeout(&event, sleep_ms);
+    wakeups++;
+
+    while (has_event) {
       switch (event.type) {
       case SDL_EventType::SDL_QUIT:
         cleanup();
@@ -119,6 +856,7 @@ int main([[maybe_unused]] int argc, [[maybe_unused]] char **argv) {
         clock::get().shuffle();
         break;
       }
+      has_event = SDL_PollEvent(&event);
     }
   }
 }
@@ -128,7 +866,30 @@ extern "C" void my_assert(char *file, int line) {
                            std::to_string(line));
 }
 
-void *spiram_allocate(size_t size) { return malloc(size); }
+void *operator new(size_t size) {
+  heap_allocations++;
+  void *ptr = malloc(size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+
+static size_t spiram_allocations = 0;
+
+void *spiram_allocate(size_t size) {
+  spiram_allocations++;
+  return malloc(size);
+}
+
+void *spiram_allocate_internal(size_t size) {
+  spiram_allocations++;
+  return malloc(size);
+}
 
 void spiram_free(void *ptr) {
   if (ptr == nullptr) {
@@ -136,3 +897,21 @@ void spiram_free(void *ptr) {
   }
   free(ptr);
 }
+
+size_t spiram_allocation_count() { return spiram_allocations; }
+
+static size_t lvgl_allocations = 0;
+
+extern "C" void *lvgl_counted_alloc(size_t size) {
+  lvgl_allocations++;
+  return malloc(size);
+}
+
+extern "C" void lvgl_counted_free(void *ptr) { free(ptr); }
+
+extern "C" void *lvgl_counted_realloc(void *ptr, size_t size) {
+  lvgl_allocations++;
+  return realloc(ptr, size);
+}
+
+extern "C" size_t lvgl_allocation_count(void) { return lvgl_allocations; }
@@ -0,0 +1,212 @@
+//   SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//   SPDX-License-Identifier: MIT
+
+#include "st7735_emulator.h"
+#include "drivers/st7735.h"
+
+#include <cstdio>
+
+constexpr uint8_t MADCTL_MY = 0x80;
+constexpr uint8_t MADCTL_MX = 0x40;
+constexpr uint8_t MADCTL_MV = 0x20;
+constexpr uint8_t MADCTL_BGR = 0x08;
+
+constexpr uint8_t COLMOD_12_BIT = 0x03;
+constexpr uint8_t COLMOD_16_BIT = 0x05;
+constexpr uint8_t COLMOD_18_BIT = 0x06;
+
+void st7735_emulator::reset() {
+  gram_pixels.fill(0);
+
+  command = CMD_NOP;
+  arg_count = 0;
+  pending_count = 0;
+
+  column_start = 0;
+  column_end = ST7735_GRAM_WIDTH - 1;
+  row_start = 0;
+  row_end = ST7735_GRAM_HEIGHT - 1;
+  column = 0;
+  row = 0;
+
+  madctl_value = 0;
+  colmod_value = 0x06; // power-on default is 18 bit
+  is_display_on = false;
+
+  pixels_written_count = 0;
+  unknown_command_count = 0;
+}
+
+void st7735_emulator::write(uint8_t dc, const uint8_t *data, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    if (dc == 0) {
+      begin_command(data[i]);
+    } else if (command == CMD_RAMWR) {
+      pixel_byte(data[i]);
+    } else {
+      argument(data[i]);
+    }
+  }
+}
+
+void st7735_emulator::begin_command(uint8_t opcode) {
+  command = opcode;
+  arg_count = 0;
+  pending_count = 0;
+
+  switch (opcode) {
+  case CMD_SWRESET: {
+    uint32_t written = pixels_written_count;
+    uint32_t unknown = unknown_command_count;
+    reset();
+    pixels_written_count = written; // counters span resets
+    unknown_command_count = unknown;
+    break;
+  }
+  case CMD_DISPON:
+    is_display_on = true;
+    break;
+  case CMD_DISPOFF:
+    is_display_on = false;
+    break;
+  case CMD_RAMWR:
+    column = column_start;
+    row = row_start;
+    break;
+  case CMD_NOP:
+  case CMD_SLPIN:
+  case CMD_SLPOUT:
+  case CMD_PTLON:
+  case CMD_NORON:
+  case CMD_INVOFF:
+  case CMD_INVON:
+  case CMD_CASET:
+  case CMD_RASET:
+  case CMD_MADCTL:
+  case CMD_COLMOD:
+  case CMD_FRMCTR1:
+  case CMD_FRMCTR2:
+  case CMD_FRMCTR3:
+  case CMD_INVCTR:
+  case CMD_DISSET5:
+  case CMD_PWCTR1:
+  case CMD_PWCTR2:
+  case CMD_PWCTR3:
+  case CMD_PWCTR4:
+  case CMD_PWCTR5:
+  case CMD_VMCTR1:
+  case CMD_PWCTR6:
+  case CMD_GMCTRP1:
+  case CMD_GMCTRN1:
+    break;
+  default:
+    unknown_command_count++;
+    printf("st7735: unknown command 0x%02x\n", opcode);
+    break;
+  }
+}
+
+void st7735_emulator::argument(uint8_t byte) {
+  if (arg_count < sizeof(args)) {
+    args[arg_count] = byte;
+  }
+  arg_count++;
+
+  switch (command) {
+  case CMD_CASET:
+    if (arg_count == 4) {
+      column_start = (args[0] << 8) | args[1];
+      column_end = (args[2] << 8) | args[3];
+    }
+    break;
+  case CMD_RASET:
+    if (arg_count == 4) {
+      row_start = (args[0] << 8) | args[1];
+      row_end = (args[2] << 8) | args[3];
+    }
+    break;
+  case CMD_MADCTL:
+    if (arg_count == 1) {
+      madctl_value = byte;
+      if (byte & MADCTL_MV) {
+        printf("st7735: MADCTL row/column exchange is not emulated\n");
+      }
+    }
+    break;
+  case CMD_COLMOD:
+    if (arg_count == 1) {
+      colmod_value = byte & 0x07;
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+static uint16_t expand_rgb444(uint8_t red, uint8_t green, uint8_t blue) {
+  return ((red << 1 | red >> 3) << 11) | ((green << 2 | green >> 2) << 5) |
+         (blue << 1 | blue >> 3);
+}
+
+// Unpacks the wire format selected by COLMOD into RGB565 pixels.
+void st7735_emulator::pixel_byte(uint8_t byte) {
+  pending[pending_count++] = byte;
+
+  switch (colmod_value) {
+  case COLMOD_12_BIT:
+    // RRRRGGGG BBBBRRRR GGGGBBBB: two pixels per three bytes, each written
+    // as soon as its twelve bits are in
+    if (pending_count == 2) {
+      store_pixel(expand_rgb444(pending[0] >> 4, pending[0] & 0x0F,
+                                pending[1] >> 4));
+      return;
+    }
+    if (pending_count < 3) {
+      return;
+    }
+    store_pixel(
+        expand_rgb444(pending[1] & 0x0F, pending[2] >> 4, pending[2] & 0x0F));
+    break;
+  case COLMOD_18_BIT:
+    // RRRRRR00 GGGGGG00 BBBBBB00
+    if (pending_count < 3) {
+      return;
+    }
+    store_pixel(((pending[0] >> 3) << 11) | ((pending[1] >> 2) << 5) |
+                (pending[2] >> 3));
+    break;
+  case COLMOD_16_BIT:
+  default:
+    // RRRRRGGG GGGBBBBB, big endian
+    if (pending_count < 2) {
+      return;
+    }
+    store_pixel((pending[0] << 8) | pending[1]);
+    break;
+  }
+
+  pending_count = 0;
+}
+
+void st7735_emulator::store_pixel(uint16_t rgb565) {
+  if (column <= column_end && row <= row_end && column < ST7735_GRAM_WIDTH &&
+      row < ST7735_GRAM_HEIGHT) {
+    // mirroring and colour order are relative to how the panel is mounted
+    uint8_t flipped = madctl_value ^ ST7735_REFERENCE_MADCTL;
+    uint16_t x = (flipped & MADCTL_MX) ? ST7735_GRAM_WIDTH - 1 - column : column;
+    uint16_t y = (flipped & MADCTL_MY) ? ST7735_GRAM_HEIGHT - 1 - row : row;
+    if (flipped & MADCTL_BGR) {
+      rgb565 = (rgb565 & 0x07E0) | (rgb565 >> 11) | ((rgb565 & 0x1F) << 11);
+    }
+    gram_pixels[y * ST7735_GRAM_WIDTH + x] = rgb565;
+  }
+  pixels_written_count++;
+
+  // the write pointer runs along the row, then wraps to the window's next row
+  if (column < column_end) {
+    column++;
+    return;
+  }
+  column = column_start;
+  row = row < row_end ? row + 1 : row_start;
+}
@@ -0,0 +1,72 @@
+//   SPDX-FileCopyrightText: 2023 Ian Levesque <ian@ianlevesque.org>
+//   SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Just enough of an ST7735 controller to check what the driver actually puts
+// on the wire: address windows, RAMWR, MADCTL mirroring and the pixel
+// formats. Everything else is decoded only far enough to consume its
+// arguments.
+
+constexpr uint16_t ST7735_GRAM_WIDTH = 132;
+constexpr uint16_t ST7735_GRAM_HEIGHT = 162;
+
+// the MADCTL the panels are mounted for; other values show up mirrored
+constexpr uint8_t ST7735_REFERENCE_MADCTL = 0xC8;
+
+class st7735_emulator {
+public:
+  st7735_emulator() { reset(); }
+
+  void reset();
+  void write(uint8_t dc, const uint8_t *data, size_t length);
+
+  // GRAM as the viewer sees it, native RGB565, ST7735_GRAM_WIDTH per row
+  const uint16_t *gram() const { return gram_pixels.data(); }
+
+  uint32_t pixels_written() const { return pixels_written_count; }
+  uint32_t unknown_commands() const { return unknown_command_count; }
+  bool display_on() const { return is_display_on; }
+  uint8_t madctl() const { return madctl_value; }
+  uint8_t colmod() const { return colmod_value; }
+
+private:
+  void begin_command(uint8_t opcode);
+  void argument(uint8_t byte);
+  void pixel_byte(uint8_t byte);
+  void store_pixel(uint16_t rgb565);
+
+  std::array<uint16_t, ST7735_GRAM_WIDTH * ST7735_GRAM_HEIGHT> gram_pixels;
+
+  uint8_t command;
+  uint8_t args[4];
+  size_t arg_count;
+
+  uint16_t column_start, column_end, row_start, row_end;
+  uint16_t column, row;
+
+  uint8_t pending[3]; // partial pixel bytes until the format's unit is in
+  size_t pending_count;
+
+  uint8_t madctl_value;
+  uint8_t colmod_value;
+  bool is_display_on;
+
+  uint32_t pixels_written_count;
+  uint32_t unknown_command_count;
+};
+
+// Cost of the bus as the ESP32 drives it: every queued transaction pays a
+// fixed setup (queue, pre_cb, DMA descriptor, post_cb), then the bytes go out
+// at the SCK rate. Good enough to compare driver changes, not to predict the
+// last microsecond.
+constexpr uint32_t ST7735_TRANSACTION_OVERHEAD_NS = 12 * 1000;
+
+constexpr uint64_t st7735_transaction_ns(size_t bytes, uint32_t clock_hz) {
+  return ST7735_TRANSACTION_OVERHEAD_NS +
+         static_cast<uint64_t>(bytes) * 8 * 1000 * 1000 * 1000 / clock_hz;
+}